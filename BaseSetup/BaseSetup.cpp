@@ -6,14 +6,13 @@
 //
 
 #include "BaseSetup.hpp"
-#include "Scheduler.hpp"
-
-Scheduler* scheduler = nullptr;
 
 BaseSetup::BaseSetup(void)
 {
-    osc = new Oscillator();
+    osc = new Oscillator(*context);
     AddUG(osc);
+    AddOutputUG(osc);
+    SetDenormalProtection(true);
 }
 
 BaseSetup::~BaseSetup(void)
@@ -21,17 +20,16 @@ BaseSetup::~BaseSetup(void)
     delete osc;
 }
 
-void BaseSetup::RouteAudio(double** mixChannels)
+void BaseSetup::RouteAudio(PfxSample** mixChannels)
 {
-    int i, j;
+    unsigned i, j;
     
-    for (i=0; i<Unit::bufferSize; i++)
-        for (int j=0; j<ugIndex; j++)
-            ugs[j]->Sample(i);
+    ProcessUGs();
     
-    for (i=0; i<2; i++)
-        for (j=0; j<Unit::bufferSize; j++)
+    for (i=0; i<MixChans(); i++)
+        for (j=0; j<context->BufferSize(); j++)
             mixChannels[i][j] = 0.0;
     
-    osc->MixOutputSamples(mixChannels, 2);
+    osc->MixOutputSamples(mixChannels, MixChans());
+    MixRoutes(mixChannels);
 }
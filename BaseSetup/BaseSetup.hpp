@@ -17,5 +17,5 @@ public:
     BaseSetup(void);
    ~BaseSetup(void);
     
-    void RouteAudio(double** mixChannels);
+    void RouteAudio(PfxSample** mixChannels);
 };
@@ -0,0 +1,55 @@
+//
+//  AudioContext.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "AudioContext.hpp"
+#include "BufferArena.hpp"
+
+AudioContext::AudioContext(double rate, unsigned blockSize) : samplingRate(rate), bufferSize(blockSize), arena(nullptr), scheduler(nullptr), graphVersion(0)
+{
+    if (samplingRate <= 0.0) samplingRate = 44100.0;
+    if (bufferSize   == 0)   bufferSize   = 512;
+}
+
+/* Units still holding buffers keep the arena alive; it frees itself when they are gone */
+AudioContext::~AudioContext(void)
+{
+    if (arena != nullptr)
+        arena->Retire();
+}
+
+AudioContext& AudioContext::Default(void)
+{
+    static AudioContext context;
+    return context;
+}
+
+void AudioContext::SetBufferSize(unsigned b)
+{
+    if (b > 0) bufferSize = b;
+}
+
+void AudioContext::SetSampleRate(double r)
+{
+    if (r > 0.0) samplingRate = r;
+}
+
+BufferArena* AudioContext::Arena(void)
+{
+    if (arena == nullptr || arena->BufferSize() != bufferSize)
+        CreateArena(kArenaUnits);
+    return arena;
+}
+
+/*
+ Units already holding buffers keep using the old arena, which frees itself
+ when the last of them is destroyed.  Call this after SetBufferSize and
+ before building the Units so the whole graph shares one block.
+*/
+void AudioContext::CreateArena(unsigned numUnits)
+{
+    if (arena != nullptr)
+        arena->Retire();
+    arena = new BufferArena(bufferSize, numUnits * kArenaChans);
+}
@@ -0,0 +1,52 @@
+//
+//  AudioContext.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Everything a graph of Units shares: sampling rate, block size, the arena
+//  their buffers come from, the Scheduler that times their events, and the
+//  version counter that tells a Score its graph was rewired.  Each engine
+//  (a Pfx and its Score, or an offline renderer) owns one, so several can
+//  run side by side at different rates and block sizes.  Units constructed
+//  without one use AudioContext::Default(), which is what the static Unit
+//  setters configure.
+//
+//  Set the rate and block size before building Units in the context: each
+//  Unit sizes its buffers and derived constants when it is constructed.
+//
+
+#pragma once
+
+#include <atomic>
+using namespace std;
+
+class AudioContext
+{
+public:
+    static const unsigned kArenaUnits = 256;    // Units a fresh arena is sized for
+    static const unsigned kArenaChans = 2;      // channels per Unit a fresh arena is sized for
+
+private:
+    double             samplingRate;
+    unsigned           bufferSize;
+    class BufferArena* arena;                   // where new Units in this context get their buffers
+    class Scheduler*   scheduler;               // not owned
+    atomic<unsigned>   graphVersion;            // bumped whenever an inputUnit or effect link changes
+
+public:
+                       AudioContext(double rate = 44100.0, unsigned blockSize = 512);
+                      ~AudioContext(void);
+
+    class BufferArena* Arena(void);                             // current arena, created for kArenaUnits if there is none
+    unsigned           BufferSize(void)     const { return bufferSize;          }
+    void               CreateArena(unsigned numUnits);          // size a fresh arena for 'numUnits' Units of bufferSize samples
+    class Scheduler*   GetScheduler(void)   const { return scheduler;           }
+    unsigned           GraphVersion(void)   const { return graphVersion.load(memory_order_acquire); }
+    void               GraphChanged(void)         { graphVersion.fetch_add(1, memory_order_release); }
+    double             SamplingRate(void)   const { return samplingRate;        }
+    double             SamplingRateMS(void) const { return samplingRate / 1000.0; }
+    void               SetBufferSize(unsigned b);
+    void               SetSampleRate(double r);
+    void               SetScheduler(class Scheduler* s) { scheduler = s;        }
+
+    static AudioContext& Default(void);                         // the context of Units built without one
+};
@@ -0,0 +1,132 @@
+//
+//  BlockAdapter.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "BlockAdapter.hpp"
+#include <cstring>
+
+BlockAdapter::BlockAdapter(void) : blockSize(0), out(nullptr), outChans(0), outPos(0), in(nullptr), inChans(0), ring(nullptr), ringMask(0), ringWrite(0), ringRead(0), render(nullptr), renderContext(nullptr) {}
+
+BlockAdapter::~BlockAdapter(void)
+{
+    FreeRing();
+}
+
+void BlockAdapter::FreeRing(void)
+{
+    if (ring == nullptr) return;
+    for (unsigned c=0; c<inChans; c++)
+        delete [] ring[c];
+    delete [] ring;
+    ring = nullptr;
+}
+
+/*
+ The ring holds a block plus two of the largest host buffers, so neither
+ a slow start nor a burst of small callbacks overruns it.  Allocates;
+ call while audio is stopped.
+*/
+void BlockAdapter::Configure(unsigned block, PfxSample** outBlock, unsigned numOut, float** inBlock, unsigned numIn, unsigned maxHostFrames)
+{
+    FreeRing();
+    blockSize = block;
+    out       = outBlock;
+    outChans  = numOut;
+    outPos    = blockSize;                      // nothing rendered yet
+    in        = inBlock;
+    inChans   = (inBlock != nullptr) ? numIn : 0;
+
+    unsigned length = 1;
+    while (length < blockSize + 2*maxHostFrames) length <<= 1;
+    ringMask = length - 1;
+    ringWrite.store(0);
+    ringRead .store(0);
+    if (inChans == 0) return;
+
+    ring = new float*[inChans];
+    for (unsigned c=0; c<inChans; c++)
+        ring[c] = new float[length]();
+}
+
+/* frames that would overrun the ring are dropped, since only the reader may move ringRead */
+void BlockAdapter::Write(const float* const* host, unsigned hostChans, unsigned frames)
+{
+    if (ring == nullptr) return;
+
+    unsigned w    = ringWrite.load(memory_order_relaxed);
+    unsigned r    = ringRead .load(memory_order_acquire);
+    unsigned room = ringMask + 1 - (w - r);
+    if (frames > room) frames = room;
+
+    unsigned at    = w & ringMask;
+    unsigned split = ringMask + 1 - at;
+    if (split > frames) split = frames;
+    for (unsigned c=0; c<inChans; c++)
+    {
+        if (c < hostChans)
+        {
+            memcpy(ring[c] + at, host[c],         split          * sizeof(float));
+            memcpy(ring[c],      host[c] + split, (frames-split) * sizeof(float));
+        }
+        else
+        {
+            memset(ring[c] + at, 0, split          * sizeof(float));
+            memset(ring[c],      0, (frames-split) * sizeof(float));
+        }
+    }
+    ringWrite.store(w + frames, memory_order_release);
+}
+
+void BlockAdapter::LoadInput(void)
+{
+    if (ring == nullptr) return;
+
+    unsigned r     = ringRead .load(memory_order_relaxed);
+    unsigned avail = ringWrite.load(memory_order_acquire) - r;
+    unsigned take  = (avail < blockSize) ? avail : blockSize;
+    unsigned pad   = blockSize - take;          // underrun: this much more latency from now on
+    unsigned at    = r & ringMask;
+    unsigned split = ringMask + 1 - at;
+    if (split > take) split = take;
+
+    for (unsigned c=0; c<inChans; c++)
+    {
+        memset(in[c], 0, pad * sizeof(float));
+        memcpy(in[c] + pad,         ring[c] + at, split        * sizeof(float));
+        memcpy(in[c] + pad + split, ring[c],      (take-split) * sizeof(float));
+    }
+    ringRead.store(r + take, memory_order_release);
+}
+
+void BlockAdapter::Read(float* const* host, unsigned hostChans, unsigned frames)
+{
+    unsigned done = 0;
+
+    while (done < frames)
+    {
+        if (outPos >= blockSize)
+        {
+            LoadInput();
+            if (render) (*render)(renderContext);
+            outPos = 0;
+        }
+
+        unsigned n = blockSize - outPos;
+        if (n > frames - done) n = frames - done;
+        for (unsigned c=0; c<hostChans; c++)
+        {
+            float* dst = host[c] + done;
+            if (c < outChans)
+            {
+                const PfxSample* src = out[c] + outPos;
+                for (unsigned j=0; j<n; j++)
+                    dst[j] = static_cast<float>(src[j]);
+            }
+            else
+                memset(dst, 0, n * sizeof(float));
+        }
+        outPos += n;
+        done   += n;
+    }
+}
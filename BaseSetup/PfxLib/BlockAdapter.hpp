@@ -0,0 +1,57 @@
+//
+//  BlockAdapter.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Decouples the host's callback size from the block size the graph runs
+//  at.  On the output side the rendered block itself is the FIFO: Read
+//  hands the host whatever is left of it and renders the next block only
+//  when that runs out, so no output is delayed.  On the input side host
+//  frames are queued in a ring and handed to the graph one block at a
+//  time.  The ring starts empty; if a block is due before enough input
+//  has arrived, the shortfall is padded with zeros at its start, which
+//  sets the input latency to the smallest value that pattern of callback
+//  sizes needs.
+//
+//  Write runs on the input callback and Read on the output callback; the
+//  ring is single-producer / single-consumer, so they may be different
+//  threads.
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+#include <atomic>
+using namespace std;
+
+typedef void (*renderfun)(void* context);      // render one block into the output buffers
+
+class BlockAdapter
+{
+private:
+    unsigned         blockSize;                 // samples the graph renders at a time
+    PfxSample**      out;                       // the graph's rendered block (not owned)
+    unsigned         outChans;
+    unsigned         outPos;                    // next sample of 'out' to hand the host; blockSize when used up
+    float**          in;                        // the graph's input block (not owned)
+    unsigned         inChans;
+    float**          ring;                      // queued host input, per channel
+    unsigned         ringMask;                  // ring length - 1
+    atomic<unsigned> ringWrite;                 // frames written, ever (input callback)
+    atomic<unsigned> ringRead;                  // frames read, ever (output callback)
+    renderfun        render;
+    void*            renderContext;
+
+public:
+             BlockAdapter(void);
+            ~BlockAdapter(void);
+
+    void     Configure(unsigned block, PfxSample** outBlock, unsigned numOut, float** inBlock, unsigned numIn, unsigned maxHostFrames);
+    unsigned Queued(void) const { return ringWrite.load(memory_order_acquire) - ringRead.load(memory_order_acquire); }   // input frames waiting
+    void     Read (float* const* host, unsigned hostChans, unsigned frames);         // fill host output buffers, rendering blocks as needed
+    void     SetRender(renderfun f, void* ctx) { render = f; renderContext = ctx; }
+    void     Write(const float* const* host, unsigned hostChans, unsigned frames);   // queue host input
+
+private:
+    void     FreeRing(void);
+    void     LoadInput(void);                   // move one block of queued input into 'in'
+};
@@ -0,0 +1,69 @@
+//
+//  BufferArena.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "BufferArena.hpp"
+#include <new>
+
+BufferArena::BufferArena(unsigned size, unsigned numBuffers) : bufferSize(size), outstanding(0), retired(false)
+{
+    const unsigned perLine = kAlignment / sizeof(PfxSample);
+
+    stride       = ((bufferSize + perLine - 1) / perLine) * perLine;
+    chunkBuffers = (numBuffers > 0) ? numBuffers : 1;
+    AddBlock(chunkBuffers + 1);
+    silence = Allocate();
+    outstanding--;                              // the arena holds it for its whole life
+}
+
+BufferArena::~BufferArena(void)
+{
+    for (PfxSample* b : blocks)
+        ::operator delete(b, align_val_t(kAlignment));
+}
+
+/*
+ Reserve 'numBuffers' buffers in one aligned allocation.  The first block is
+ sized from the expected unit count; further blocks are only added if the
+ graph outgrows that estimate, so buffers stay contiguous in the normal case.
+*/
+void BufferArena::AddBlock(unsigned numBuffers)
+{
+    size_t     bytes = static_cast<size_t>(stride) * numBuffers * sizeof(PfxSample);
+    PfxSample* block = static_cast<PfxSample*>(::operator new(bytes, align_val_t(kAlignment)));
+
+    blocks.push_back(block);
+    freeList.reserve(freeList.size() + numBuffers);
+    for (unsigned i=numBuffers; i>0; i--)               // hand out in address order
+        freeList.push_back(block + static_cast<size_t>(stride) * (i-1));
+}
+
+PfxSample* BufferArena::Allocate(void)
+{
+    if (freeList.empty())
+        AddBlock(chunkBuffers);
+
+    PfxSample* b = freeList.back();
+    freeList.pop_back();
+    for (unsigned i=0; i<stride; i++)
+        b[i] = 0.0;
+    outstanding++;
+    return b;
+}
+
+void BufferArena::Release(PfxSample* buffer)
+{
+    if (buffer == nullptr) return;
+    freeList.push_back(buffer);
+    outstanding--;
+    if (retired && outstanding == 0)
+        delete this;
+}
+
+void BufferArena::Retire(void)
+{
+    retired = true;
+    if (outstanding == 0)
+        delete this;
+}
@@ -0,0 +1,46 @@
+//
+//  BufferArena.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  One contiguous, 64-byte aligned block carved into equal sample buffers.
+//  Units take their output buffers from the arena instead of the heap, so
+//  the buffers of a whole graph sit next to each other and every channel
+//  starts on a cache line (and therefore on any SIMD boundary).
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+#include <vector>
+using namespace std;
+
+class BufferArena
+{
+public:
+    static const unsigned kAlignment = 64;          // bytes; one cache line
+
+private:
+    unsigned           bufferSize;                  // samples in each buffer
+    unsigned           stride;                      // samples between buffer starts, rounded up to kAlignment
+    unsigned           chunkBuffers;                // buffers per block
+    unsigned           outstanding;                 // buffers currently handed out
+    PfxSample*         silence;                     // one zeroed buffer shared by every reader; never written
+    bool               retired;                     // replaced by a newer arena; delete when the last buffer comes back
+    vector<PfxSample*> blocks;                      // first block plus any overflow blocks
+    vector<PfxSample*> freeList;                    // buffers ready to hand out
+
+public:
+                BufferArena(unsigned bufferSize, unsigned numBuffers);
+               ~BufferArena(void);
+
+    PfxSample*  Allocate(void);                     // hand out a zeroed, aligned buffer of bufferSize samples
+    unsigned    Available(void)  const { return static_cast<unsigned>(freeList.size()); }
+    unsigned    BufferSize(void) const { return bufferSize;  }
+    unsigned    Outstanding(void) const { return outstanding; }
+    PfxSample*  Silence(void)     const { return silence;     }    // read-only buffer of zeros
+    void        Release(PfxSample* buffer);         // return a buffer to the arena
+    void        Retire(void);                       // stop using this arena; it frees itself once empty
+
+private:
+    void        AddBlock(unsigned numBuffers);
+};
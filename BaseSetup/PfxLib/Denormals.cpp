@@ -0,0 +1,40 @@
+//
+//  Denormals.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "Denormals.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+    #include <xmmintrin.h>
+    static const unsigned long kFlushBits = 0x8040;            // FTZ (bit 15) | DAZ (bit 6)
+    static unsigned long GetMode(void)            { return _mm_getcsr(); }
+    static void          SetMode(unsigned long m) { _mm_setcsr(static_cast<unsigned>(m)); }
+#elif defined(__aarch64__)
+    static const unsigned long kFlushBits = 1ul << 24;         // FZ
+    static unsigned long GetMode(void)            { unsigned long m; __asm__ __volatile__("mrs %0, fpcr" : "=r"(m)); return m; }
+    static void          SetMode(unsigned long m) { __asm__ __volatile__("msr fpcr, %0" : : "r"(m)); }
+#else
+    static const unsigned long kFlushBits = 0;
+    static unsigned long GetMode(void)            { return 0; }
+    static void          SetMode(unsigned long)   {}
+#endif
+
+DenormalGuard::DenormalGuard(bool enable) : saved(0), engaged(enable)
+{
+    if (!engaged) return;
+    saved = GetMode();
+    if ((saved & kFlushBits) != kFlushBits)
+        SetMode(saved | kFlushBits);
+}
+
+DenormalGuard::~DenormalGuard(void)
+{
+    if (engaged && (GetMode() != saved))
+        SetMode(saved);
+}
+
+void FlushDenormals(void)
+{
+    SetMode(GetMode() | kFlushBits);
+}
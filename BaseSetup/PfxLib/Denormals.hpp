@@ -0,0 +1,24 @@
+//
+//  Denormals.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Flush-to-zero / denormals-are-zero control for the calling thread.
+//  With both set the FPU treats denormal inputs and results as zero, so
+//  decaying tails cost no more than any other sample.  On x86 this is the
+//  FTZ and DAZ bits of MXCSR; on arm64 the FZ bit of FPCR covers both.
+//  Other targets compile to no-ops.
+//
+
+#pragma once
+
+class DenormalGuard                             // set FTZ/DAZ for a scope, then restore the previous mode
+{
+    unsigned long saved;
+    bool          engaged;
+
+public:
+    explicit DenormalGuard(bool enable = true);
+            ~DenormalGuard(void);
+};
+
+void FlushDenormals(void);                      // set FTZ/DAZ on the calling thread for good (e.g. as a WorkerPool thread init)
@@ -0,0 +1,89 @@
+//
+//  EnvelopeShapes.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "EnvelopeShapes.hpp"
+#include "Envelopes.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+
+EnvelopeTable::EnvelopeTable(const PfxSample* src, long n) : storage(n + kGuardBefore + kGuardAfter, PfxSample(0)), size(n)
+{
+    PfxSample* dst = storage.data() + kGuardBefore;
+
+    for (long i=0; i<n; i++)
+        dst[i] = src[i];
+    dst[-1] = (n > 0) ? dst[0] : PfxSample(0);
+}
+
+static atomic<long>                                              resolution(EnvelopeShapes::kDefaultResolution);
+static mutex                                                     libraryLock;
+static map<pair<int, long>, shared_ptr<const EnvelopeTable>>     library;
+
+long EnvelopeShapes::Resolution(void)
+{
+    return resolution.load(memory_order_relaxed);
+}
+
+void EnvelopeShapes::SetResolution(long points)
+{
+    if (points > 1)
+        resolution.store(points, memory_order_relaxed);
+}
+
+// The generators are the Envelopes shape functions, so a library table
+// matches what filling a buffer of the same length by hand would give.
+
+static void Build(EnvelopeShapes::shape s, PfxSample* env, long n)
+{
+    switch (s)
+    {
+        case EnvelopeShapes::kAttack:        Envelopes::Attack       (env, n); break;
+        case EnvelopeShapes::kGaussian:      Envelopes::Gaussian     (env, n); break;
+        case EnvelopeShapes::kHexagon:       Envelopes::Hexagon      (env, n); break;
+        case EnvelopeShapes::kM:             Envelopes::M            (env, n); break;
+        case EnvelopeShapes::kReverseAttack: Envelopes::ReverseAttack(env, n); break;
+        case EnvelopeShapes::kSine:          Envelopes::Sine         (env, n); break;
+        case EnvelopeShapes::kSquare:        Envelopes::Square       (env, n); break;
+        case EnvelopeShapes::kTriangle:      Envelopes::Triangle     (env, n); break;
+        case EnvelopeShapes::kHann:
+        {
+            vector<float> window(n);
+            Envelopes::Hann(window.data(), n);
+            for (long i=0; i<n; i++)
+                env[i] = window[i];
+            break;
+        }
+    }
+}
+
+shared_ptr<const EnvelopeTable> EnvelopeShapes::Get(shape s, long points)
+{
+    if (points <= 0)
+        points = Resolution();
+
+    lock_guard<mutex> hold(libraryLock);
+    shared_ptr<const EnvelopeTable>& entry = library[make_pair((int)s, points)];
+    if (!entry)
+    {
+        vector<PfxSample> env(points + 1, PfxSample(0));    // Triangle writes the midpoint of odd lengths one past n/2
+        Build(s, env.data(), points);
+        entry = make_shared<const EnvelopeTable>(env.data(), points);
+    }
+    return entry;
+}
+
+void EnvelopeShapes::Purge(void)
+{
+    lock_guard<mutex> hold(libraryLock);
+    for (auto i = library.begin(); i != library.end(); )
+    {
+        if (i->second.use_count() == 1)
+            i = library.erase(i);
+        else
+            ++i;
+    }
+}
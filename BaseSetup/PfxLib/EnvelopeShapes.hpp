@@ -0,0 +1,48 @@
+//
+//  EnvelopeShapes.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Read-only envelope tables shared by every Envelopes instance.  Each
+//  shape is built the first time someone asks for it, at the library's
+//  resolution (points per shape, independent of the sampling rate), and
+//  then handed out by shared_ptr; an Envelopes plays it back at whatever
+//  speed its duration needs.  A voice costs a pointer, not a table.
+//
+//  EnvelopeTable carries guard points for the Interpolators: one copy of
+//  the first point before the start, and three zeros after the end, since
+//  every shape finishes at silence.
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+#include <memory>
+#include <vector>
+using namespace std;
+
+class EnvelopeTable
+{
+    vector<PfxSample> storage;
+    long              size;
+
+public:
+    static const int  kGuardBefore = 1;
+    static const int  kGuardAfter  = 3;
+
+                      EnvelopeTable(const PfxSample* src, long n);      // copies 'n' points and adds the guards
+
+    const PfxSample*  Points(void) const        { return storage.data() + kGuardBefore; }
+    long              Size(void) const          { return size; }
+};
+
+class EnvelopeShapes
+{
+public:
+    enum shape { kAttack, kGaussian, kHexagon, kM, kReverseAttack, kSine, kSquare, kTriangle, kHann };
+    static const long kDefaultResolution = 8192;
+
+    static shared_ptr<const EnvelopeTable> Get(shape s, long resolution = 0);  // 0: the current Resolution()
+    static long                            Resolution(void);
+    static void                            SetResolution(long points);        // for tables requested from now on
+    static void                            Purge(void);                       // drop tables no Envelopes holds
+};
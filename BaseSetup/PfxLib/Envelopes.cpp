@@ -9,57 +9,84 @@
 
 #include "Envelopes.hpp"
 #include "Scheduler.hpp"
+#include "MixKernels.hpp"
 #include <math.h>
+#include <vector>
 
-extern Scheduler* scheduler;
+Envelopes::Envelopes(void) : Envelopes(AudioContext::Default()) {}
 
-Envelopes::Envelopes(void) : ADSRaccum(0.0), ADSRsample(0), increment(1.0), index(0.0), duration(1000)
+Envelopes::Envelopes(AudioContext& ctx) : Unit(ctx), index(0.0), duration(1000), increment(1.0), ADSRp(), ADSRseg(), ADSRaccum(0.0), ADSRsample(0), level(1.0),
+    loopStart(-1), loopEnd(-1), looping(false), triggerAt(-1), releasing(false)
 {
     numChans  = 1;
     tableMS   = 1000.0;
-    tableSize = static_cast<unsigned int>(Unit::samplingRate);
+    tableSize = 0;
     ADSRphase = 0;
     eType     = kADSR;
     completed = false;
-    if (tableSize == 0) tableSize = 44100;
-    points = new double[tableSize];      // reference envelope one second long
+    interp    = Interpolation::kLinear;
     Attack();
+    increment = tableSize / (samplingRate > 0 ? samplingRate : 44100.0);   // the reference envelope lasts one second
 }
 
-Envelopes::~Envelopes(void) { delete [] points; }
+Envelopes::~Envelopes(void) {}
 
 /*
- Morph between two envelopes and place in env buffer.  Note that no FFT envelopes are
- allowed as inputs
+ Shapes come from the shared library; a voice only holds a reference.  The
+ playback increment is rescaled so a change of resolution keeps the duration.
+*/
+void Envelopes::SetShape(EnvelopeShapes::shape s, long resolution)
+{
+    UseTable(EnvelopeShapes::Get(s, resolution));
+}
+
+void Envelopes::UseTable(shared_ptr<const EnvelopeTable> t)
+{
+    unsigned int oldSize = tableSize;
+
+    shapeTable = std::move(t);
+    points     = shapeTable->Points();
+    tableSize  = static_cast<unsigned int>(shapeTable->Size());
+    if (oldSize > 0)
+    {
+        increment *= static_cast<double>(tableSize) / oldSize;
+        index     *= static_cast<double>(tableSize) / oldSize;
+    }
+}
+
+/*
+ Morph between two envelopes and place the result in a table of this
+ instance's own, leaving the shared shapes untouched.  Note that no FFT
+ envelopes are allowed as inputs
 */
 void Envelopes::AmplitudeMorph(int startType, int endType)
 {
 	int i;
-	double* Q		 = new double[tableSize];
+	vector<PfxSample> Q(tableSize + 1), morph(tableSize);
 	int envelopeType = startType;
 
     for (i=0; i<2; i++)
 	{
 		switch(envelopeType)
 		{
-		  case 1: Gaussian	   (Q, tableSize); break;
-		  case 2: Triangle	   (Q, tableSize); break;
-		  case 3: Square	   (Q, tableSize); break;
-		  case 4: Attack	   (Q, tableSize); break;
-		  case 5: Sine		   (Q, tableSize); break;
-		  case 6: ReverseAttack(Q, tableSize); break;
-		  case 7: Hexagon	   (Q, tableSize); break;
-		  case 8: M			   (Q, tableSize); break;
+		  case 1: Gaussian	   (Q.data(), tableSize); break;
+		  case 2: Triangle	   (Q.data(), tableSize); break;
+		  case 3: Square	   (Q.data(), tableSize); break;
+		  case 4: Attack	   (Q.data(), tableSize); break;
+		  case 5: Sine		   (Q.data(), tableSize); break;
+		  case 6: ReverseAttack(Q.data(), tableSize); break;
+		  case 7: Hexagon	   (Q.data(), tableSize); break;
+		  case 8: M			   (Q.data(), tableSize); break;
 		}
 		if (i == 0)
 			for (i=0; i<tableSize; i++)
-				points[i] = Q[i];
+				morph[i] = Q[i];
 		envelopeType = endType;
 	}
 	for (i=0; i<tableSize; i++)
-		points[i] = Q[i] + (points[i]-Q[i]);
+		morph[i] = Q[i] + (morph[i]-Q[i]);
 
-	delete [] Q;
+	UseTable(make_shared<const EnvelopeTable>(morph.data(), tableSize));
 }  
 
 /*
@@ -70,9 +97,9 @@ void Envelopes::AmplitudeMorph(int startType, int endType)
  asymptotically approaches zero, this function will never equal zero.
  Its integral will approximately be 1.
 */
-void Envelopes::Attack(void) { Attack(points, tableSize); }
+void Envelopes::Attack(void) { SetShape(EnvelopeShapes::kAttack); }
 
-void Envelopes::Attack(double* env, double len)
+void Envelopes::Attack(PfxSample* env, double len)
 {
     int i;
     const double e = 2.71828;
@@ -92,7 +119,7 @@ void Envelopes::Attack(double* env, double len)
  will never equal zero. The factor allows you to scale the curve as desired.  The
  integral of the envelope will approximately equal the factor.
 */
-void Envelopes::Gaussian(double* env, double length, double factor)
+void Envelopes::Gaussian(PfxSample* env, double length, double factor)
 {
 	double SD	   = (double)((length)/6);
 	const double e = 2.71828; 
@@ -107,7 +134,7 @@ void Envelopes::Gaussian(double* env, double length, double factor)
  factor to 1.0, meaning the integral of the envelope over
  its length will approximately by equal to 1.
 */
-void Envelopes::Gaussian(double* env, double length)
+void Envelopes::Gaussian(PfxSample* env, double length)
 {
 	Gaussian(env, length, 1.0);
 }
@@ -121,7 +148,7 @@ void Envelopes::Gaussian(double* env, double length)
  a hexagonal wave.  Instead, think of this just as a 
  regular trapezoid.
 */
-void Envelopes::Hexagon(double* env, double length)
+void Envelopes::Hexagon(PfxSample* env, double length)
 {
     int i;
 	int endSlope = (int)(length/3);
@@ -140,7 +167,7 @@ void Envelopes::Hexagon(double* env, double length)
  rising back to 1 over the next 1/6, and finally falling back
  to 0 over its last 1/3.
 */
-void Envelopes::M(double* env, double length)
+void Envelopes::M(PfxSample* env, double length)
 {
     int i;
 	int endSlope = (int)(length/3);
@@ -161,7 +188,7 @@ void Envelopes::M(double* env, double length)
  distribution.  This creates a smooth curve with a long attack and quick 
  decay.
 */
-void Envelopes::ReverseAttack(double* env, double length)
+void Envelopes::ReverseAttack(PfxSample* env, double length)
 {
     int i;
 	const double e = 2.71828;
@@ -179,7 +206,7 @@ void Envelopes::ReverseAttack(double* env, double length)
  This creates the first half of a sine wave over the 
  length of the (double) buffer.
 */
-void Envelopes::Sine(double* env, double length)
+void Envelopes::Sine(PfxSample* env, double length)
 {
 	const double pi = 4.0 * atan(1.0);
 	for (int i=0; i<length; i++)
@@ -195,7 +222,7 @@ void Envelopes::Sine(double* env, double length)
  are have slopes of 8/length and -8/length respectively 
  (instead of the theoretical infinity and -infinity).
 */
-void Envelopes::Square(double* env, double length)
+void Envelopes::Square(PfxSample* env, double length)
 {
     int i;
 	int endSlope = (int)(length/8);
@@ -215,7 +242,7 @@ void Envelopes::Square(double* env, double length)
  of the buffer size and then that fall linearly to 0 over 
  the second half.
 */
-void Envelopes::Triangle(double* env, double length)
+void Envelopes::Triangle(PfxSample* env, double length)
 {
 	double	 i    = 0.0;
 	double	 mean = length / 2.0;
@@ -247,7 +274,7 @@ void Envelopes::Hann(float* env, float length)
 	}
 }
 
-void Envelopes::SetEnvelope(int type, double* env, unsigned envLen)
+void Envelopes::SetEnvelope(int type, PfxSample* env, unsigned envLen)
 {
     switch (type)
     {
@@ -263,36 +290,43 @@ void Envelopes::SetEnvelope(int type, double* env, unsigned envLen)
     }
 }
 
+/* scheduled attacks start on the sample the task fell on */
 void Hit(void* args)
 {
     Envelopes* e = static_cast<Envelopes*>(args);
-    e->index = 0.0;
-    e->TurnOn();
+    e->Trigger(Scheduler::BlockOffset());
 }
 
 #include <iostream>
 
 void Envelopes::calculateADSRParams(double duration, double attackPct, double decayPct, double releasePct, double sustainLevel)
 {
-    double samplesPerMS = Unit::samplingRate / 1000.0;
+    double samplesPerMS = samplingRate / 1000.0;
     // Calculate the duration of each phase in samples
     ADSRp.attackSamples  = static_cast<int>(duration * attackPct  * samplesPerMS);
     ADSRp.decaySamples   = static_cast<int>(duration * decayPct   * samplesPerMS);
     ADSRp.releaseSamples = static_cast<int>(duration * releasePct * samplesPerMS);
     ADSRp.sustainSamples = static_cast<int>(duration * samplesPerMS) - (ADSRp.attackSamples + ADSRp.decaySamples + ADSRp.releaseSamples);
+    if (ADSRp.sustainSamples < 0) ADSRp.sustainSamples = 0;
+    ADSRp.sustainLevel   = sustainLevel;
+    BuildADSRSegments();
+}
 
-    // Calculate increments/decrements for each phase
-    ADSRp.attackIncrement = 1.0 / ADSRp.attackSamples;
-    ADSRp.attackTarget    = 1.0; // Target amplitude of attack phase is always 1.0
-
-    // For decay, we want to go from 1.0 to sustainLevel
-    ADSRp.decayIncrement = (sustainLevel - 1.0) / ADSRp.decaySamples;
-
-    // Sustain level is constant, so no increment needed
-    ADSRp.sustainLevel = sustainLevel;
+void Envelopes::SetADSRCurves(double attack, double decay, double release)
+{
+    ADSRp.attackCurve  = attack;
+    ADSRp.decayCurve   = decay;
+    ADSRp.releaseCurve = release;
+    BuildADSRSegments();
+}
 
-    // For release, we decrease from sustainLevel to 0
-    ADSRp.releaseIncrement = -sustainLevel / ADSRp.releaseSamples;
+/* attack to 1, decay to the sustain level, hold it, release to silence */
+void Envelopes::BuildADSRSegments(void)
+{
+    ADSRseg[0] = { 1.0,                ADSRp.attackSamples,  ADSRp.attackCurve  };
+    ADSRseg[1] = { ADSRp.sustainLevel, ADSRp.decaySamples,   ADSRp.decayCurve   };
+    ADSRseg[2] = { ADSRp.sustainLevel, ADSRp.sustainSamples, 0.0                };
+    ADSRseg[3] = { 0.0,                ADSRp.releaseSamples, ADSRp.releaseCurve };
 }
 
 /* Fire: schedules envelope attacks */
@@ -300,11 +334,11 @@ void Envelopes::Fire(long onset)
 {
     // if the onset time is zero, fire immediately
     if (onset == 0L)
-        Hit(static_cast<void*>(this));
+        Trigger(0);
     else
         // otherwise schedule event later
-        if (scheduler)
-            scheduler->ScheduleTask(onset, 0, Hit, static_cast<void*>(this));
+        if (context->GetScheduler())
+            context->GetScheduler()->ScheduleTask(onset, 0, Hit, static_cast<void*>(this));
 }
 
 /* Fire: schedules envelope attacks */
@@ -313,48 +347,216 @@ void Envelopes::Fire(long onset, double duration)
     increment = ((static_cast<double>(tableSize)/samplingRate)*1000.0)/duration;
     // if the onset time is zero, fire immediately
     if (onset == 0L)
-        Hit(static_cast<void*>(this));
+        Trigger(0);
     else
         // otherwise schedule event later
-        if (scheduler)
-            scheduler->ScheduleTask(onset, 0, Hit, static_cast<void*>(this));
+        if (context->GetScheduler())
+            context->GetScheduler()->ScheduleTask(onset, 0, Hit, static_cast<void*>(this));
 }
 
+/* start over in whatever type was configured (SetEtype, or TurnOn(envType)) */
 void Envelopes::TurnOn(void)
+{
+    TurnOn(eType);
+}
+
+void Envelopes::TurnOn(envType e)
 {
     active     = true;
     completed  = false;
     ADSRaccum  = 0.0;
     ADSRphase  = 0;
     ADSRsample = 0;
-    eType      = kADSR;
+    looping    = (loopStart >= 0);
+    eType      = e;
+    releasing.store(false, memory_order_relaxed);
+    Wake();
 }
 
-void Envelopes::TurnOn(envType e)
+/*
+ Sample-accurate restart, for callers that know where in the coming block
+ a note lands; scheduled Fires and CNotes pass Scheduler::BlockOffset().
+ Segment envelopes start over from the level they are at, so a retrigger
+ mid-note does not click.  An envelope that is off (never started, or a
+ shape that has played through) counts as finished, so it stays silent
+ up to the trigger point.
+*/
+void Envelopes::Trigger(long offset)
+{
+    if (!active)
+        completed = true;
+    active = true;
+    triggerAt.store((offset > 0) ? offset : 0, memory_order_release);
+    Wake();
+}
+
+void Envelopes::Restart(void)
 {
     active     = true;
     completed  = false;
-    ADSRaccum  = 0.0;
+    index      = 0.0;
     ADSRphase  = 0;
     ADSRsample = 0;
-    eType      = e;
+    looping    = (loopStart >= 0);
+}
+
+/*
+ Segments to play as eType kBreakpoints.  A loop needs loopFrom <= loopTo,
+ both in range, and at least one sample between them; otherwise the
+ envelope plays through once.  The vector is the one Process walks, so
+ only replace it while audio is stopped.
+*/
+void Envelopes::SetBreakpoints(const vector<EnvSegment>& segs, int loopFrom, int loopTo)
+{
+    long loopSamples = 0;
+
+    breakpoints = segs;
+    for (int i=loopFrom; i>=0 && i<=loopTo && i<(int)segs.size(); i++)
+        loopSamples += segs[i].samples;
+    if (loopFrom < 0 || loopTo < loopFrom || loopTo >= (int)segs.size() || loopSamples <= 0)
+        loopFrom = loopTo = -1;
+    loopStart = loopFrom;
+    loopEnd   = loopTo;
+    looping   = (loopStart >= 0) && looping;
+}
+
+// Release may come from any thread; the audio thread acts on it.
+
+void Envelopes::Release(void)
+{
+    releasing.store(true, memory_order_release);
+    Wake();
+}
+
+void Envelopes::LeaveLoop(void)
+{
+    if (looping && ADSRphase >= loopStart && ADSRphase <= loopEnd)
+    {
+        ADSRphase  = loopEnd + 1;               // on to the release segments, from the current level
+        ADSRsample = 0;
+        if (ADSRphase >= (int)breakpoints.size())
+            completed = true;
+    }
+    looping = false;
 }
 
-void Envelopes::Sample(int sNo)
+void Envelopes::Process(int first, int count)
 {
-    for (int i=0; i<numChans; i++)
-        outputSamples[i][sNo] = 0.0;
-    
-    if (!active)   return;
-    if (completed) return;
+    int last = first + count;
 
-    double gain = 1.0;
-    if (eType == kShapes)
+    for (unsigned c=0; c<numChans; c++)
+        KernelZero(outputSamples[c] + first, count);
+
+    if (releasing.exchange(false, memory_order_acquire))
+        LeaveLoop();
+
+    // Take any pending trigger; if it lands in a later block, hand back
+    // what is left unless a newer Trigger has arrived meanwhile.
+    long pending = triggerAt.exchange(-1, memory_order_acquire);
+    if (pending >= count)
     {
-        double pt1 = points[(int)index];
-        double i2  = index+1.0;
-        double pt2 = 0.0;
-        if (i2 >= tableSize)
+        long none = -1;
+        triggerAt.compare_exchange_strong(none, pending - count, memory_order_relaxed);
+        Render(first, last);
+    }
+    else if (pending >= 0)
+    {
+        int at = first + static_cast<int>(pending);
+        Render(first, at);
+        Restart();
+        Render(at, last);
+    }
+    else
+        Render(first, last);
+    ApplyLevel(first, count);
+}
+
+void Envelopes::Render(int first, int last)
+{
+    switch (eType)
+    {
+        case kShapes:
+            switch (interp)
+            {
+                case Interpolation::kTruncate: RenderShape<Interpolation::kTruncate>(first, last); break;
+                case Interpolation::kHermite:  RenderShape<Interpolation::kHermite> (first, last); break;
+                case Interpolation::kLagrange: RenderShape<Interpolation::kLagrange>(first, last); break;
+                default:                       RenderShape<Interpolation::kLinear>  (first, last); break;
+            }
+            break;
+        case kBreakpoints: RenderSegments(breakpoints.data(), (int)breakpoints.size(), first, last); break;
+        default:           RenderSegments(ADSRseg, 4, first, last); break;      // filled a segment piece at a time
+    }
+}
+
+/*
+ Walk the segments over [first, last).  Each piece runs to the end of the
+ block or of its segment, whichever comes first, and is filled by one
+ kernel call; the segment only changes between pieces.
+*/
+void Envelopes::RenderSegments(const EnvSegment* seg, int numSegs, int first, int last)
+{
+    PfxSample* out = outputSamples[0];
+
+    if (ADSRphase >= numSegs)
+        completed = true;
+    for (int j=first; j<last && active && !completed; )
+    {
+        const EnvSegment& s = seg[ADSRphase];
+        if (ADSRsample < s.samples)
+        {
+            long left = s.samples - ADSRsample;
+            int  n    = static_cast<int>(left < last - j ? left : last - j);
+            ADSRaccum   = RenderSegment(out + j, n, ADSRaccum, s.target, left, s.curve, s.samples);
+            ADSRsample += n;
+            j          += n;
+        }
+        if (ADSRsample >= s.samples)
+        {
+            ADSRaccum  = s.target;              // land exactly on the target
+            ADSRsample = 0;
+            if (eType == kBreakpoints && looping && ADSRphase == loopEnd)
+                ADSRphase = loopStart;
+            else if (++ADSRphase >= numSegs)
+                completed = true;
+        }
+    }
+}
+
+/*
+ Fill 'n' samples of a segment that has 'left' samples to go from 'from'
+ to 'to', and return the level reached.  Picking up from the current
+ level rather than the segment's start lets a piece begin anywhere: a
+ line through two points is the same line, and an exponential with the
+ segment's ratio through the current level and the target is the same
+ exponential.
+*/
+double Envelopes::RenderSegment(PfxSample* out, int n, double from, double to, long left, double curve, long length)
+{
+    double ratio = exp(-curve / length);
+    double span  = 1.0 - pow(ratio, (double)left);
+
+    if (curve == 0.0 || fabs(span) < 1e-9)
+    {
+        double step = (to - from) / left;
+        KernelRamp(out, from + step, step, n);
+        return from + step * n;
+    }
+    double scale = (to - from) / span;          // y(k) = from + scale * (1 - ratio^k), k = 1..left
+    KernelGeometric(out, from + scale, -scale * ratio, ratio, n);
+    return from + scale * (1.0 - pow(ratio, (double)n));
+}
+
+template <Interpolation::mode M>
+void Envelopes::RenderShape(int first, int last)
+{
+    PfxSample* out = outputSamples[0];
+
+    for (int j=first; j<last && active && !completed; j++)
+    {
+        int i1 = (int)index;
+        out[j] = Interpolator<M>::Read(points, i1, index - i1);
+        if (i1 + 1 >= (int)tableSize)
         {
             TurnOff();
             completed = true;
@@ -362,7 +564,6 @@ void Envelopes::Sample(int sNo)
         }
         else
         {
-            pt2 = points[(int)i2];
             index += increment;
             if (index >= tableSize)
             {
@@ -370,48 +571,26 @@ void Envelopes::Sample(int sNo)
                 index = 0.0;
             }
         }
-        gain = pt1 + ((index - ((int)index)) * (pt2 - pt1));
-    } else  // eType == kADSR
-    {
-        switch (ADSRphase) {
-            case 0: // Attack
-                ADSRaccum += ADSRp.attackIncrement;
-                if (ADSRsample++ >= ADSRp.attackSamples) {
-                    ADSRphase++;
-                    ADSRaccum  = ADSRp.attackTarget; // Ensure we reach the exact target
-                    ADSRsample = 0;
-                }
-                break;
-            case 1: // Decay
-                ADSRaccum += ADSRp.decayIncrement;
-                if (ADSRsample++ >= ADSRp.decaySamples) {
-                    ADSRphase++;
-                    ADSRaccum  = ADSRp.sustainLevel; // Ensure we reach sustain level
-                    ADSRsample = 0;
-                }
-                break;
-            case 2: // Sustain
-                ADSRaccum = ADSRp.sustainLevel;     // Sustain level is constant
-                if (ADSRsample++ >= ADSRp.sustainSamples) {
-                    ADSRphase++;
-                    ADSRsample = 0;
-                }
-                break;
-            case 3: // Release
-                ADSRaccum += ADSRp.releaseIncrement;
-                if (ADSRsample++ >= ADSRp.releaseSamples) {
-                    ADSRphase++;      // Indicates the envelope is complete
-                    ADSRaccum  = 0.0; // Ensure we end at silence
-                    ADSRsample = 0;
-                }
-                break;
-            default:
-                completed = true;
-                ADSRaccum = 0.0;    // End of envelope
-                break;
-        }
-        gain = ADSRaccum;
     }
+}
 
-    outputSamples[0][sNo] = gain;
+void Envelopes::SetLevel(double l, long ms)
+{
+    level.SetTarget(l, MsToSamples(ms));
+}
+
+/* a steady level of 1 costs one test; anything else is one ramped multiply per piece, unclipped so levels above 1 survive */
+void Envelopes::ApplyLevel(int first, int count)
+{
+    if (!level.Moving() && (level.Current() == 1.0))
+        return;
+
+    PfxSample* out = outputSamples[0] + first;
+    for (int done=0; done<count; )
+    {
+        double   g, dg;
+        unsigned n = level.Segment(count - done, g, dg);
+        KernelScale(out + done, g, dg, n);
+        done += n;
+    }
 }
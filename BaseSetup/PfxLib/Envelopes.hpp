@@ -9,27 +9,43 @@
 #pragma	once
 
 #include "Unit.hpp"
+#include "Interpolators.hpp"
+#include "EnvelopeShapes.hpp"
+#include <vector>
 
 struct ADSRParams
 {
     int    attackSamples;
-    double attackIncrement;
-    double attackTarget;
+    double attackCurve;                         // see EnvSegment::curve
 
     int    decaySamples;
-    double decayIncrement;
+    double decayCurve;
 
     int    sustainSamples;
     double sustainLevel;
 
     int    releaseSamples;
-    double releaseIncrement;
+    double releaseCurve;
+};
+
+/*
+ One piece of a segment envelope: a move from wherever the envelope is to
+ 'target' over 'samples'.  A curve of 0 is a straight line; otherwise the
+ segment is a one-pole exponential spanning 'curve' time constants, fast
+ first and slow into the target (negative curves are slow first), pinned
+ so it lands on the target exactly.
+*/
+struct EnvSegment
+{
+    double target;
+    long   samples;                             // 0 jumps straight to the target
+    double curve;
 };
 
 class Envelopes : public Unit
 {
 public:
-    enum envType { kShapes, kADSR };
+    enum envType { kShapes, kADSR, kBreakpoints };
     bool           completed;
     double         index;
     double         tableMS;
@@ -40,36 +56,67 @@ private:
     envType        eType;
     double         increment;
     ADSRParams     ADSRp;
-    double         ADSRaccum;
-    int            ADSRphase;
-    int            ADSRsample;
-    double*        points;
+    EnvSegment     ADSRseg[4];                  // attack, decay, sustain, release, built from ADSRp
+    double         ADSRaccum;                   // level of the last sample rendered
+    int            ADSRphase;                   // current segment
+    long           ADSRsample;                  // samples rendered of the current segment
+    const PfxSample* points;                    // tableSize points of shapeTable, guard points either side
+    shared_ptr<const EnvelopeTable> shapeTable; // shared from EnvelopeShapes, or private after AmplitudeMorph
+    Interpolation::mode interp;                 // how kShapes reads the points
+    SmoothedValue  level;                       // scales the rendered envelope; glides so level changes do not click
+    vector<EnvSegment> breakpoints;             // kBreakpoints: played in order from the level the envelope is at
+    int            loopStart;                   // segments [loopStart, loopEnd] repeat until Release; -1 for no loop
+    int            loopEnd;
+    bool           looping;
+    atomic<long>   triggerAt;                   // samples into the coming blocks at which Trigger restarts; -1 for none
+    atomic<bool>   releasing;                   // Release was called; Process leaves the loop at its next block
 
 public:
     Envelopes(void);
+    Envelopes(AudioContext& ctx);
     virtual ~Envelopes(void);
     
-    void	AmplitudeMorph(int startType, int endType);                 // morph between two envelopes and place results in env buffer
+    void	AmplitudeMorph(int startType, int endType);                 // morph between two envelopes into a private table
 	void	Attack		  (void);								        // A quick attack (using a Gaussian with small SD)
-    void    Attack        (double* env, double length);                 // followed by a long decay (using a Gaussian with large SD)
-	void	Gaussian	  (double* env, double length);					// 3 SDs from the mean of a simple Gaussian
-	void	Gaussian	  (double* env, double length, double factor);  // 3 SDs from the mean of a simple Gaussian scaled by the 'factor'
+    static void Attack    (PfxSample* env, double length);              // followed by a long decay (using a Gaussian with large SD)
+	static void Gaussian  (PfxSample* env, double length);				// 3 SDs from the mean of a simple Gaussian
+	static void Gaussian  (PfxSample* env, double length, double factor); // 3 SDs from the mean of a simple Gaussian scaled by the 'factor'
     void calculateADSRParams(double duration, double attackPct, double decayPct, double releasePct, double sustainLevel);
-    void	Hexagon		  (double* env, double length);                 // A trapezoidal shape
-	void	M			  (double* env, double length);                 // The shape of an 'M'
-	void	ReverseAttack (double* env, double length);                 // Produces the opposite of 'Attack' (see above)
-	void	Sine		  (double* env, double length);                 // double version of half cycle of a sine wave
-	void	Square		  (double* env, double length);                 // half cycle of a square wave
-	void	Triangle	  (double* env, double length);                 // half cycle of a triangle wave
+    void    SetADSRCurves(double attack, double decay, double release);   // EnvSegment curves; 0 is linear, the default
+    static void Hexagon	  (PfxSample* env, double length);              // A trapezoidal shape
+	static void M		  (PfxSample* env, double length);              // The shape of an 'M'
+	static void ReverseAttack(PfxSample* env, double length);           // Produces the opposite of 'Attack' (see above)
+	static void Sine	  (PfxSample* env, double length);              // half cycle of a sine wave
+	static void Square	  (PfxSample* env, double length);              // half cycle of a square wave
+	static void Triangle  (PfxSample* env, double length);              // half cycle of a triangle wave
 	/* Common Window Functions for FFT use */
-	void	Hann		  (float* env,  float length);                  // Hann window
+	static void Hann	  (float* env,  float length);                  // Hann window
 
     void    Fire(long onset);
     void    Fire(long onset, double duration);
     double  GetPoint(unsigned int i) { return points[i]; }
-    void    SetEnvelope(int type, double* env, unsigned envLen);
+    bool    Idle(void) const override { return completed && triggerAt.load(memory_order_relaxed) < 0; }
+    void    SetEnvelope(int type, PfxSample* env, unsigned envLen);
+    void    Release(void);                      // leave the breakpoint loop and play the segments after it, from the next block
+    void    SetBreakpoints(const vector<EnvSegment>& segs, int loopFrom = -1, int loopTo = -1);  // replaces the segments: only while audio is stopped
     void    SetEtype(envType e) { eType = e; }
-    void    Sample(int sNo);
-    void    TurnOn(void);
+    void    SetShape(EnvelopeShapes::shape s, long resolution = 0);   // play a shared library shape; 0: library resolution
+    void    SetInterpolation(Interpolation::mode m) { interp = m; }
+    void    SetLevel(double l, long ms = 0);    // peak level of the envelope, reached over 'ms'
+    void    Process(int first, int count) override;
+    void    TurnOn(void);                       // restart in the configured envType
     void    TurnOn(envType e);
+    void    Trigger(long offset = 0);           // restart 'offset' samples into the next block, from the current level
+
+private:
+    void    ApplyLevel(int first, int count);
+    void    UseTable(shared_ptr<const EnvelopeTable> t);
+    void    BuildADSRSegments(void);
+    void    LeaveLoop(void);
+    void    Render(int first, int last);
+    void    RenderSegments(const EnvSegment* seg, int numSegs, int first, int last);
+    void    Restart(void);
+    static double RenderSegment(PfxSample* out, int n, double from, double to, long left, double curve, long length);
+    template <Interpolation::mode M>
+    void    RenderShape(int first, int last);
 };
@@ -0,0 +1,121 @@
+//
+//  Fft.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "Fft.hpp"
+#include <math.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+bool IsPowerOfTwo(long n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+void Fft(double* re, double* im, long n, bool inverse)
+{
+    if (!IsPowerOfTwo(n))
+        return;
+
+    for (long i=1, j=0; i<n; i++)               // bit-reversal permutation
+    {
+        long bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            swap(re[i], re[j]);
+            swap(im[i], im[j]);
+        }
+    }
+
+    double sign = inverse ? 1.0 : -1.0;
+    for (long len=2; len<=n; len<<=1)           // butterflies, doubling the span each pass
+    {
+        double angle = sign * 2.0 * M_PI / len;
+        double wRe   = cos(angle), wIm = sin(angle);
+        for (long i=0; i<n; i+=len)
+        {
+            double uRe = 1.0, uIm = 0.0;
+            for (long k=0; k<len/2; k++)
+            {
+                long   a   = i + k, b = a + len/2;
+                double tRe = re[b]*uRe - im[b]*uIm;
+                double tIm = re[b]*uIm + im[b]*uRe;
+                re[b]  = re[a] - tRe;
+                im[b]  = im[a] - tIm;
+                re[a] += tRe;
+                im[a] += tIm;
+                double nRe = uRe*wRe - uIm*wIm;
+                uIm = uRe*wIm + uIm*wRe;
+                uRe = nRe;
+            }
+        }
+    }
+}
+
+/*
+ Bluestein: with jk = (j*j + k*k - (j-k)*(j-k)) / 2, X[j] is the chirp
+ w[j] = exp(sign i pi j*j / n) times the convolution of x[k] w[k] with
+ conj(w).  The convolution is circular over m >= 2n - 1 points, so the
+ wrapped tail never reaches the n outputs kept.  j*j is reduced mod 2n
+ before it becomes an angle, which keeps the chirp exact for large n.
+*/
+void Dft(double* re, double* im, long n, bool inverse)
+{
+    if (n <= 0)
+        return;
+    if (IsPowerOfTwo(n))
+    {
+        Fft(re, im, n, inverse);
+        return;
+    }
+
+    long m = 1;
+    while (m < 2 * n - 1)
+        m <<= 1;
+
+    double         sign = inverse ? 1.0 : -1.0;
+    vector<double> wRe(n), wIm(n);
+    for (long k=0; k<n; k++)
+    {
+        double angle = sign * M_PI * (double)((k * k) % (2 * n)) / n;
+        wRe[k] = cos(angle);
+        wIm[k] = sin(angle);
+    }
+
+    vector<double> aRe(m, 0.0), aIm(m, 0.0), bRe(m, 0.0), bIm(m, 0.0);
+    for (long k=0; k<n; k++)
+    {
+        aRe[k] = re[k]*wRe[k] - im[k]*wIm[k];
+        aIm[k] = re[k]*wIm[k] + im[k]*wRe[k];
+    }
+    bRe[0] = wRe[0];
+    bIm[0] = -wIm[0];
+    for (long k=1; k<n; k++)
+    {
+        bRe[k] = bRe[m - k] =  wRe[k];
+        bIm[k] = bIm[m - k] = -wIm[k];
+    }
+
+    Fft(aRe.data(), aIm.data(), m);
+    Fft(bRe.data(), bIm.data(), m);
+    for (long k=0; k<m; k++)
+    {
+        double r = aRe[k]*bRe[k] - aIm[k]*bIm[k];
+        aIm[k]   = aRe[k]*bIm[k] + aIm[k]*bRe[k];
+        aRe[k]   = r;
+    }
+    Fft(aRe.data(), aIm.data(), m, true);
+
+    for (long k=0; k<n; k++)
+    {
+        double cRe = aRe[k] / m, cIm = aIm[k] / m;
+        re[k] = cRe*wRe[k] - cIm*wIm[k];
+        im[k] = cRe*wIm[k] + cIm*wRe[k];
+    }
+}
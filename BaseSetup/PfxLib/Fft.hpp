@@ -0,0 +1,18 @@
+//
+//  Fft.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  In-place iterative radix-2 complex FFT on split real/imaginary arrays.
+//  This runs off the audio thread, for building tables from a harmonic
+//  spectrum and for analysis, so it favours plain double precision over
+//  speed.  Fft needs n to be a power of two; Dft takes any n and hands
+//  other sizes to Bluestein's chirp-z method, which turns the transform
+//  into a convolution done with padded power-of-two Ffts.  Both leave the
+//  inverse transform unscaled.
+//
+
+#pragma once
+
+bool IsPowerOfTwo(long n);
+void Fft(double* re, double* im, long n, bool inverse = false);
+void Dft(double* re, double* im, long n, bool inverse = false);
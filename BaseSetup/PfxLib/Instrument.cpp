@@ -10,12 +10,12 @@
 #include <iostream>
 using namespace std;
 
-extern Scheduler* scheduler;
+Instrument::Instrument(void) : Instrument(AudioContext::Default()) {}
 
-Instrument::Instrument(void)
+Instrument::Instrument(AudioContext& ctx) : Unit(ctx)
 {
     numChans = 1;
-    env      = new Envelopes;
+    env      = new Envelopes(ctx);
     env->SetEtype(Envelopes::kADSR);
     env->calculateADSRParams(1000, 0.01, 0.1, 0.4, 0.25);
     usingEnvelope = false;
@@ -35,6 +35,7 @@ void CNote(void* args)
 
 void Instrument::BeatNote(double onsetBeat, int pitch, int velocity, double duration)
 {
+    Scheduler* scheduler = context->GetScheduler();
     double msTime = (60000.0 / scheduler->MM);          // beat duration in milliseconds
     long   dur    = static_cast<long>(msTime*duration); // length of note in milliseconds
 
@@ -64,6 +65,7 @@ void Instrument::MakeNote(long onset, int pitch, int velocity, long duration)
         return;
     }
     
+    Scheduler* scheduler = context->GetScheduler();
     if (scheduler == nullptr)
     {
         cout << "No scheduler" << endl;
@@ -82,6 +84,7 @@ void Instrument::MakeNote(long onset, int pitch, int velocity, long duration)
 /* MakeNote: schedules transmission of NoteOut messages to perform Note object at regular intervals*/
 Task* Instrument::MakeNote(long onset, int pitch, int velocity, long duration, int IOI)
 {
+    Scheduler* scheduler = context->GetScheduler();
     if (scheduler == nullptr)
     {
         cout << "No scheduler" << endl;
@@ -103,8 +106,39 @@ void Instrument::NoteOut(int pitch, int velocity, long durationMS)
 {
     SetFreq(pitch);
     SetVolume(VelocityToAmplitude(velocity));
-    env->TurnOn();
+    env->Trigger(Scheduler::BlockOffset());    // on the task's own sample when a CNote plays it
     usingEnvelope = true;
+    Wake();
+}
+
+/* silent after its note has released, or at zero volume with no ramp pending */
+bool Instrument::Idle(void) const
+{
+    if (bypass) return false;
+    return EnvelopeDone() || ((volume.Current() == 0.0) && !volume.Moving());
+}
+
+void Instrument::Process(int first, int count)
+{
+    if (!active) return;
+    if (bypass) { Bypass(first, count); return; }
+    Unit::Process(first, count);
+    if (usingEnvelope)
+        ApplyEnvelope(first, count);
+}
+
+void Instrument::ApplyEnvelope(int first, int count)
+{
+    env->Process(first, count);
+
+    PfxSample* gain = env->OutputSamples(0);
+    int        last = first + count;
+    for (unsigned i=0; i<numChans; i++)
+    {
+        PfxSample* out = outputSamples[i];
+        for (int j=first; j<last; j++)
+            out[j] *= gain[j];
+    }
 }
 
 void Instrument::Play(Event* e)
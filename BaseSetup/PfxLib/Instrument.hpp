@@ -32,15 +32,22 @@ public:
 
 public:
     Instrument(void);
+    Instrument(AudioContext& ctx);
    ~Instrument(void);
     void  BeatNote(double onsetBeat, int pitch, int velocity, double duration);
     void  MakeNote(long onset, int pitch, int velocity, long duration);
     Task* MakeNote(long onset, int pitch, int velocity, long duration, int IOI);
     virtual void  NoteOut(int pitch, int velocity, long duration);
+    bool  Idle(void) const override;
     void  Play(Event* e);
     void  PlayEventBlock(EventBlock* eB);
+    void  Process(int first, int count) override;
     virtual void SetFreq(double freq) {}
     virtual void SetFreq(int pitch)   {}
+
+protected:
+    void  ApplyEnvelope(int first, int count);   // render env over [first, first+count) and scale the output by it
+    bool  EnvelopeDone(void) const { return usingEnvelope && (env->Idle() || !env->Active()); }   // the last note has fully released and none is pending
 };
 
 void CNote(void* args);
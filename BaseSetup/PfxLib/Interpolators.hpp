@@ -0,0 +1,84 @@
+//
+//  Interpolators.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Table-reading kernels, one specialization per quality level, so a
+//  render loop templated on the mode has its interpolation inlined and no
+//  per-sample branch.  Each reads around index i with fraction x in
+//  [0, 1) and needs kBefore points ahead of i and kAfter points past it;
+//  Wavetable's guard points cover all four.
+//
+//  kTruncate  nearest lower point; cheapest, noisiest
+//  kLinear    two points
+//  kHermite   four-point, third-order Catmull-Rom (continuous slope)
+//  kLagrange  four-point, third-order Lagrange polynomial
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+
+struct Interpolation
+{
+    enum mode { kTruncate, kLinear, kHermite, kLagrange };
+    static const char* Name(mode m);
+};
+
+template <Interpolation::mode M> struct Interpolator;
+
+template <> struct Interpolator<Interpolation::kTruncate>
+{
+    enum { kBefore = 0, kAfter = 0 };
+    static inline double Read(const PfxSample* t, long i, double)
+    {
+        return t[i];
+    }
+};
+
+template <> struct Interpolator<Interpolation::kLinear>
+{
+    enum { kBefore = 0, kAfter = 1 };
+    static inline double Read(const PfxSample* t, long i, double x)
+    {
+        double y0 = t[i], y1 = t[i + 1];
+        return y0 + (x * (y1 - y0));
+    }
+};
+
+template <> struct Interpolator<Interpolation::kHermite>
+{
+    enum { kBefore = 1, kAfter = 2 };
+    static inline double Read(const PfxSample* t, long i, double x)
+    {
+        double ym1 = t[i - 1], y0 = t[i], y1 = t[i + 1], y2 = t[i + 2];
+        double c1  = 0.5 * (y1 - ym1);
+        double c2  = ym1 - 2.5 * y0 + 2.0 * y1 - 0.5 * y2;
+        double c3  = 0.5 * (y2 - ym1) + 1.5 * (y0 - y1);
+        return ((c3 * x + c2) * x + c1) * x + y0;
+    }
+};
+
+template <> struct Interpolator<Interpolation::kLagrange>
+{
+    enum { kBefore = 1, kAfter = 2 };
+    static inline double Read(const PfxSample* t, long i, double x)
+    {
+        double ym1 = t[i - 1], y0 = t[i], y1 = t[i + 1], y2 = t[i + 2];
+        double c1  = y1 - (1.0/3.0) * ym1 - 0.5 * y0 - (1.0/6.0) * y2;
+        double c2  = 0.5 * (ym1 + y1) - y0;
+        double c3  = (1.0/6.0) * (y2 - ym1) + 0.5 * (y0 - y1);
+        return ((c3 * x + c2) * x + c1) * x + y0;
+    }
+};
+
+inline const char* Interpolation::Name(mode m)
+{
+    switch (m)
+    {
+        case kTruncate: return "truncate";
+        case kLinear:   return "linear";
+        case kHermite:  return "hermite";
+        case kLagrange: return "lagrange";
+    }
+    return "";
+}
@@ -0,0 +1,349 @@
+//
+//  MixKernels.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "MixKernels.hpp"
+#include "Simd.hpp"
+#include <math.h>
+
+template <typename T>
+static inline T ClipScalar(T x)
+{
+    if (x < T(-1)) return T(-1);
+    if (x > T( 1)) return T( 1);
+    return x;
+}
+
+template <typename T>
+void KernelZero(T* dst, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W = S::kWidth;
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+        S::Store(dst+i, S::Zero());
+    for (; i<n; i++)
+        dst[i] = T(0);
+}
+
+/*
+ The remaining kernels share one shape: a vector loop that carries the
+ gain ramp in a register (advanced by W*gainInc per step), followed by a
+ scalar tail that picks the ramp up where the vector loop left off.
+*/
+template <typename T>
+void KernelCopy(T* dst, const T* src, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        S::Store(dst+i, S::Min(hi, S::Max(lo, S::Mul(S::Load(src+i), g))));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] = ClipScalar<T>(src[i] * T(gain + gainInc*i));
+}
+
+template <typename T>
+void KernelMix(T* dst, const T* src, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Add(S::Load(dst+i), S::Mul(S::Load(src+i), g));
+        S::Store(dst+i, S::Min(hi, S::Max(lo, v)));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] = ClipScalar<T>(dst[i] + src[i] * T(gain + gainInc*i));
+}
+
+template <typename T>
+void KernelAccumulate(T* dst, const T* src, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        S::Store(dst+i, S::Add(S::Load(dst+i), S::Mul(S::Load(src+i), g)));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] += src[i] * T(gain + gainInc*i);
+}
+
+template <typename T>
+void KernelScale(T* dst, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        S::Store(dst+i, S::Mul(S::Load(dst+i), g));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] *= T(gain + gainInc*i);
+}
+
+template <typename T>
+void KernelCrossfade(T* dst, const T* a, const T* b, double x, double xInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  f  = SimdRamp<T>(T(x), T(xInc));
+    typename S::V  df = S::Set(T(xInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V va = S::Load(a+i);
+        S::Store(dst+i, S::Add(va, S::Mul(S::Sub(S::Load(b+i), va), f)));
+        f = S::Add(f, df);
+    }
+    for (; i<n; i++)
+        dst[i] = a[i] + (b[i] - a[i]) * T(x + xInc*i);
+}
+
+template <typename T>
+void KernelRamp(T* dst, double start, double step, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  v  = SimdRamp<T>(T(start), T(step));
+    typename S::V  dv = S::Set(T(step * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        S::Store(dst+i, v);
+        v = S::Add(v, dv);
+    }
+    for (; i<n; i++)
+        dst[i] = T(start + step*i);
+}
+
+/* the power term is carried as a product, W lanes apart, so the loop needs no pow */
+template <typename T>
+void KernelGeometric(T* dst, double base, double scale, double ratio, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W = S::kWidth;
+    T        lanes[S::kWidth];
+    double   p = scale, stride = 1.0;
+    unsigned i = 0;
+
+    for (unsigned k=0; k<W; k++)
+    {
+        lanes[k] = T(p);
+        p       *= ratio;
+        stride  *= ratio;
+    }
+    typename S::V b  = S::Set(T(base));
+    typename S::V v  = S::Load(lanes);
+    typename S::V dv = S::Set(T(stride));
+
+    for (; i+W<=n; i+=W)
+    {
+        S::Store(dst+i, S::Add(b, v));
+        v = S::Mul(v, dv);
+    }
+    for (p = scale * pow(ratio, (double)i); i<n; i++)
+    {
+        dst[i] = T(base + p);
+        p     *= ratio;
+    }
+}
+
+template <typename T>
+void KernelClip(T* dst, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+        S::Store(dst+i, S::Min(hi, S::Max(lo, S::Load(dst+i))));
+    for (; i<n; i++)
+        dst[i] = ClipScalar<T>(dst[i]);
+}
+
+template <typename T>
+void KernelCopyDown(T* dst, const T* srcL, const T* srcR, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain*0.5), T(gainInc*0.5));
+    typename S::V  dg = S::Set(T(gainInc*0.5 * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Mul(S::Add(S::Load(srcL+i), S::Load(srcR+i)), g);
+        S::Store(dst+i, S::Min(hi, S::Max(lo, v)));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] = ClipScalar<T>((srcL[i] + srcR[i]) * T((gain + gainInc*i) * 0.5));
+}
+
+template <typename T>
+void KernelMixDown(T* dst, const T* srcL, const T* srcR, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain*0.5), T(gainInc*0.5));
+    typename S::V  dg = S::Set(T(gainInc*0.5 * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Mul(S::Add(S::Load(srcL+i), S::Load(srcR+i)), g);
+        S::Store(dst+i, S::Min(hi, S::Max(lo, S::Add(S::Load(dst+i), v))));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dst[i] = ClipScalar<T>(dst[i] + (srcL[i] + srcR[i]) * T((gain + gainInc*i) * 0.5));
+}
+
+template <typename T>
+void KernelCopyUp(T* dstL, T* dstR, const T* src, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Min(hi, S::Max(lo, S::Mul(S::Load(src+i), g)));
+        S::Store(dstL+i, v);
+        S::Store(dstR+i, v);
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+        dstL[i] = dstR[i] = ClipScalar<T>(src[i] * T(gain + gainInc*i));
+}
+
+template <typename T>
+void KernelMixUp(T* dstL, T* dstR, const T* src, double gain, double gainInc, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(-1)), hi = S::Set(T(1));
+    typename S::V  g  = SimdRamp<T>(T(gain), T(gainInc));
+    typename S::V  dg = S::Set(T(gainInc * W));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Mul(S::Load(src+i), g);
+        S::Store(dstL+i, S::Min(hi, S::Max(lo, S::Add(S::Load(dstL+i), v))));
+        S::Store(dstR+i, S::Min(hi, S::Max(lo, S::Add(S::Load(dstR+i), v))));
+        g = S::Add(g, dg);
+    }
+    for (; i<n; i++)
+    {
+        T v = src[i] * T(gain + gainInc*i);
+        dstL[i] = ClipScalar<T>(dstL[i] + v);
+        dstR[i] = ClipScalar<T>(dstR[i] + v);
+    }
+}
+
+/*
+ The block form of Unit::CheckRange: anything whose magnitude is not inside
+ (1e-20, 1e20) -- NaN, infinity, denormals and the tiny values that decay
+ into them -- becomes zero.  NaN fails both comparisons, so it is masked
+ out along with the rest.
+*/
+template <typename T>
+void KernelSanitize(T* dst, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W  = S::kWidth;
+    typename S::V  lo = S::Set(T(1.0e-20)), hi = S::Set(T(1.0e20));
+    unsigned i = 0;
+
+    for (; i+W<=n; i+=W)
+    {
+        typename S::V v = S::Load(dst+i);
+        typename S::V a = S::Abs(v);
+        S::Store(dst+i, S::And(v, S::And(S::Less(lo, a), S::Less(a, hi))));
+    }
+    for (; i<n; i++)
+    {
+        T a = (dst[i] < T(0)) ? -dst[i] : dst[i];
+        if (!(a > T(1.0e-20) && a < T(1.0e20)))
+            dst[i] = T(0);
+    }
+}
+
+template <typename T>
+T KernelPeak(const T* src, unsigned n)
+{
+    typedef SimdVec<T> S;
+    const unsigned W = S::kWidth;
+    typename S::V  m = S::Zero();
+    unsigned i = 0;
+    T        peak = T(0);
+
+    for (; i+W<=n; i+=W)
+        m = S::Max(m, S::Abs(S::Load(src+i)));
+    T lanes[W];
+    S::Store(lanes, m);
+    for (unsigned k=0; k<W; k++)
+        if (lanes[k] > peak) peak = lanes[k];
+    for (; i<n; i++)
+    {
+        T a = (src[i] < T(0)) ? -src[i] : src[i];
+        if (a > peak) peak = a;
+    }
+    return peak;
+}
+
+#define PFX_INSTANTIATE_KERNELS(T)                                                          \
+    template void KernelZero    <T>(T*, unsigned);                                          \
+    template void KernelCopy    <T>(T*, const T*, double, double, unsigned);                \
+    template void KernelMix     <T>(T*, const T*, double, double, unsigned);                \
+    template void KernelAccumulate<T>(T*, const T*, double, double, unsigned);              \
+    template void KernelScale   <T>(T*, double, double, unsigned);                          \
+    template void KernelCrossfade<T>(T*, const T*, const T*, double, double, unsigned);     \
+    template void KernelRamp    <T>(T*, double, double, unsigned);                          \
+    template void KernelGeometric<T>(T*, double, double, double, unsigned);                 \
+    template void KernelClip    <T>(T*, unsigned);                                          \
+    template void KernelSanitize<T>(T*, unsigned);                                          \
+    template T    KernelPeak    <T>(const T*, unsigned);                                    \
+    template void KernelCopyDown<T>(T*, const T*, const T*, double, double, unsigned);      \
+    template void KernelMixDown <T>(T*, const T*, const T*, double, double, unsigned);      \
+    template void KernelCopyUp  <T>(T*, T*, const T*, double, double, unsigned);            \
+    template void KernelMixUp   <T>(T*, T*, const T*, double, double, unsigned);
+
+PFX_INSTANTIATE_KERNELS(float)
+PFX_INSTANTIATE_KERNELS(double)
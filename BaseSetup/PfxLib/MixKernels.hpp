@@ -0,0 +1,33 @@
+//
+//  MixKernels.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Block kernels used to move Unit output into mix buffers.  Every kernel
+//  applies a linear gain ramp (gain on the first sample, advancing by
+//  gainInc per sample; pass gainInc = 0 for a constant gain) and clips the
+//  result to [-1, 1], except KernelAccumulate, which leaves clipping to a
+//  final KernelClip once every source has been summed, KernelScale, which
+//  applies a gain in place to a control signal that may leave [-1, 1], and
+//  KernelCrossfade, whose ramp is a blend position rather than a gain.  KernelSanitize and
+//  KernelPeak apply no gain.  KernelRamp and KernelGeometric are generators
+//  for envelope segments: they write a line or a decaying exponential with
+//  no source and no clipping.  They are instantiated for float and double.
+//
+
+#pragma once
+
+template <typename T> void KernelZero    (T* dst, unsigned n);                                                     // dst  = 0
+template <typename T> void KernelCopy    (T* dst, const T* src, double gain, double gainInc, unsigned n);          // dst  = src * g
+template <typename T> void KernelMix     (T* dst, const T* src, double gain, double gainInc, unsigned n);          // dst += src * g
+template <typename T> void KernelAccumulate(T* dst, const T* src, double gain, double gainInc, unsigned n);        // dst += src * g, unclipped
+template <typename T> void KernelScale   (T* dst, double gain, double gainInc, unsigned n);                        // dst *= g, unclipped
+template <typename T> void KernelCrossfade(T* dst, const T* a, const T* b, double x, double xInc, unsigned n);    // dst  = a + (b-a) * x, unclipped
+template <typename T> void KernelRamp    (T* dst, double start, double step, unsigned n);                          // dst  = start + step * i
+template <typename T> void KernelGeometric(T* dst, double base, double scale, double ratio, unsigned n);           // dst  = base + scale * ratio^i
+template <typename T> void KernelClip    (T* dst, unsigned n);                                                     // dst  = clip(dst)
+template <typename T> void KernelSanitize(T* dst, unsigned n);                                                     // dst  = 0 where dst is NaN, inf or denormal-sized
+template <typename T> T    KernelPeak    (const T* src, unsigned n);                                               // largest |src|
+template <typename T> void KernelCopyDown(T* dst, const T* srcL, const T* srcR, double gain, double gainInc, unsigned n);   // dst  = (l+r)/2 * g
+template <typename T> void KernelMixDown (T* dst, const T* srcL, const T* srcR, double gain, double gainInc, unsigned n);   // dst += (l+r)/2 * g
+template <typename T> void KernelCopyUp  (T* dstL, T* dstR, const T* src, double gain, double gainInc, unsigned n);         // l  = r  = src * g
+template <typename T> void KernelMixUp   (T* dstL, T* dstR, const T* src, double gain, double gainInc, unsigned n);         // l += src * g, r += src * g
@@ -4,18 +4,35 @@
 //
 
 #include "Oscillator.hpp"
+#include "MixKernels.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <math.h>
 
-Oscillator::Oscillator(void)
+using namespace std;
+
+Oscillator::Oscillator(void) : Oscillator(AudioContext::Default()) {}
+
+Oscillator::Oscillator(AudioContext& ctx) : Instrument(ctx)
 {
     numChans      = 1;
-    frequency     = 0.0;
-    increment     = 1.0;
     index         = 0.0;
+    phase         = 0;
+    phaseShift    = -1;
+    phasing       = kFloatPhase;
     table         = nullptr;
     tableSize     = 0.0;
-    FillTable(kSine, 8192);
+    numLevels     = 0;
+    mode          = kWavetable;
+    interp        = Interpolation::kLinear;
+    fmInput       = nullptr;
+    fmDepth       = 0.0;
+    pmInput       = nullptr;
+    pmIndex       = 0.0;
+    modInc.assign(bufferSize, PfxSample(0));
+    modOffset.assign(bufferSize, PfxSample(0));
+    FillTable(kSine, Wavetable::kDefaultSize);
+    incPerHz      = tableSize / samplingRate;
     for (int i=0; i<bufferSize; i++)
         outputSamples[0][i] = 0.0;
     usingEnvelope = false;
@@ -23,101 +40,41 @@ Oscillator::Oscillator(void)
 
 Oscillator::~Oscillator(void)
 {
-    if (table != nullptr)
-        delete [] table;
 }
 
 void Oscillator::FillTable(tableType type, long size)
 {
+    if (size < Wavetable::kMinSize) return;     // keep the table we have
+    if (tableSize > 0.0)
+        index = index * size / tableSize;       // same point in the cycle in the new table
     tableSize = (float)size;
-    if (table != nullptr)
-        delete [] table;
-    table     = new double[size];
     ComputeTableSamples(type);
 }
 
 void Oscillator::FillTable(tableType type)
 {
-    if (tableSize <= 0.0) return;
+    if (tableSize < Wavetable::kMinSize) return;
     ComputeTableSamples(type);
 }
 
+// Tables come from the shared cache, so filling one is a lookup unless
+// this is the first Oscillator to ask for that shape and size.  Saw,
+// square, ramp and triangle get one band-limited level per octave; sine
+// and kTest have a single level.
+
 void Oscillator::ComputeTableSamples(tableType type)
 {
-    int i;
-    double twoPi = 8.0 * atan(1.0);
-    double value;
-    
-    switch (type)
-    {
-        case kSine:
-        {
-            double piSize = twoPi/tableSize;
-            for (i=0; i<tableSize; i++)
-                table[i] = sin(piSize*i);
-            break;
-        }
-        case kSawtooth:
-        {
-            double sawInc = 2.0/tableSize;
-            value = 1.0;
-            for (i=0; i<tableSize; i++)
-            {
-                table[i] = value;
-                value   -= sawInc;
-            }
-            break;
-        }
-        case kRamp:
-        {
-            double rampInc = 2.0/tableSize;
-            value = -1.0;
-            for (i=0; i<tableSize; i++)
-            {
-                table[i] = value;
-                value   += rampInc;
-            }
-            break;
-        }
-        case kSquare:
-        {
-            double halfSize = tableSize/2.0;
-            for (i=0; i<halfSize; i++)
-                table[i] = +0.95;
-            for (; i<tableSize; i++)
-                table[i] = -0.95;
-            break;
-        }
-        case kTriangle :
-        {
-            double quarterInc = 1.0/tableSize*4.0;
-            int limit = tableSize/4;
-            value = 0.0;
-            for (i=0; i<limit; i++)
-            {
-                table[i] = value;
-                value   += quarterInc;
-            }
-            limit = i + tableSize/2;
-            for (; i<limit; i++)
-            {
-                table[i] = value;
-                value   -= quarterInc;
-            }
-            for (; i<tableSize; i++)
-            {
-                table[i] = value;
-                value   += quarterInc;
-            }
-            break;
-        }
-        case kTest:
-        {
-            for (i=0; i<tableSize; i++)
-                table[i] = (i%2)?1.0:0.0;
-            break;
-        }
-    }
+    long size = (long)tableSize;
+
+    shape     = type;
+    phaseShift = -1;
+    for (int b=1; b<32; b++)
+        if (size == (1L << b))
+            phaseShift = 32 - b;
+    numLevels = Wavetable::Levels(Wavetable::shape(type), size);
+    for (int l=0; l<Wavetable::kMaxLevels; l++)
+        levels[l] = (l < numLevels) ? WavetableCache::Get(Wavetable::shape(type), size, l) : nullptr;
+    table     = levels[0] ? levels[0]->Samples() : nullptr;
 }
 
 void Oscillator::SetFreq(int pitch)
@@ -131,10 +88,43 @@ void Oscillator::SetFreq(double freq)
     if (table == nullptr || tableSize == 0.0)
         return;
 
-    // Set the oscillator's frequency
-    frequency = freq;
-    // Calculate the increment needed to advance to the next sample based on the new frequency and table size, assuming the global sampling rate
-    increment = frequency * tableSize / samplingRate;
+    // Set the oscillator's frequency (Process glides to it if a glide time is set)
+    frequency.SetTarget(freq);
+    // Table positions to advance per sample for each Hz, assuming the global sampling rate
+    incPerHz = tableSize / samplingRate;
+}
+
+void Oscillator::SetFrequencyModulation(Unit* src, double hzPerUnit)
+{
+    fmInput = src;
+    fmDepth = hzPerUnit;
+    context->GraphChanged();
+    Wake();
+}
+
+void Oscillator::SetPhaseModulation(Unit* src, double radiansPerUnit)
+{
+    pmInput = src;
+    pmIndex = radiansPerUnit;
+    context->GraphChanged();
+    Wake();
+}
+
+int Oscillator::Inputs(Unit** in, int max) const
+{
+    int n = Instrument::Inputs(in, max);
+
+    if (fmInput != nullptr && n < max)
+        in[n++] = fmInput;
+    if (pmInput != nullptr && pmInput != fmInput && n < max)
+        in[n++] = pmInput;
+    return n;
+}
+
+void Oscillator::SetGlide(double ms, SmoothedValue::smoothMode m)
+{
+    frequency.SetMode(m);
+    frequency.SetRamp(MsToSamples(ms));
 }
 
 void Oscillator::TurnOn(double freq)
@@ -143,8 +133,9 @@ void Oscillator::TurnOn(double freq)
         return;
 
     active    = true;
-    frequency = freq;
-    increment = frequency * tableSize / samplingRate;
+    frequency.SetTarget(freq, 0);
+    incPerHz  = tableSize / samplingRate;
+    Wake();
 }
 
 void Oscillator::TurnOn(double freq, double rate)
@@ -153,34 +144,336 @@ void Oscillator::TurnOn(double freq, double rate)
         return;
 
     active    = true;
-    frequency = freq;
-    increment = frequency * tableSize / rate;
+    frequency.SetTarget(freq, 0);
+    incPerHz  = tableSize / rate;
+    Wake();
+}
+
+// Smallest level whose band limit holds for increments up to inc.
+
+int Oscillator::LevelFor(double inc) const
+{
+    int e;
+    frexp(inc, &e);                             // inc < 2^e
+    if (e < 0)
+        e = 0;
+    return (e < numLevels) ? e : max(numLevels - 1, 0);
+}
+
+template <Interpolation::mode M>
+void Oscillator::RenderTable(PfxSample* out, int first, int end, int, double& idx, double inc, double di, double vol)
+{
+    double           size = tableSize;
+    double           top  = fmax(fabs(inc), fabs(inc + di * (end - first)));
+    const PfxSample* tab  = levels[LevelFor(top)]->Samples();
+
+    for (int j=first; j<end; j++)
+    {
+        int i1 = (int)idx;                      // guard points cover the neighbours; no wrap test
+
+        out[j] = Interpolator<M>::Read(tab, i1, idx - i1) * vol;
+
+        idx += inc;
+        inc += di;
+        while (idx >= size)
+            idx -= size;
+        while (idx < 0.0)
+            idx += size;
+    }
+}
+
+// Q32.32 phase units per sample for an increment in table positions.  A
+// cycle is 2^64 of these, so Nyquist (half a cycle) is 2^63; the clamp is
+// the largest double below that, and anything faster would alias anyway.
+// Callers accumulate the step as uint64_t, where a glide that crosses
+// the clamp wraps instead of overflowing.
+
+int64_t Oscillator::ToFixed(double positions) const
+{
+    double fx = ldexp(positions, phaseShift + 32);
+    fx = fmin(fmax(fx, -0x1.fffffffffffffp62), 0x1.fffffffffffffp62);
+    return (int64_t)llround(fx);
+}
+
+/*
+ Fixed-point phase: the top bits of the 32-bit accumulator index the
+ table and the bits below them are the interpolation fraction.  Wrapping
+ is the unsigned overflow and the guard points cover the interpolator's
+ neighbours, so the loop has no branches.  The increment (and any glide step) is Q32.32, rounded
+ to whole phase units each sample, so a steady tone repeats exactly.
+*/
+template <Interpolation::mode M>
+void Oscillator::RenderTableFixed(PfxSample* out, int first, int end, int, double&, double inc, double di, double vol)
+{
+    double           top   = fmax(fabs(inc), fabs(inc + di * (end - first)));
+    const PfxSample* tab   = levels[LevelFor(top)]->Samples();
+    const int        shift = phaseShift;
+    const uint32_t   mask  = (uint32_t)((1ULL << shift) - 1);
+    const double     scale = ldexp(1.0, -shift);
+    uint64_t         step  = ToFixed(inc), dstep = ToFixed(di);
+    uint32_t         ph    = phase;
+
+    for (int j=first; j<end; j++)
+    {
+        uint32_t i1 = ph >> shift;
+
+        out[j] = Interpolator<M>::Read(tab, i1, (ph & mask) * scale) * vol;
+
+        ph   += (uint32_t)((step + 0x80000000ULL) >> 32);
+        step += dstep;
+    }
+    phase = ph;
+}
+
+// Two-sample polynomial approximation of the band-limited step residual:
+// added at each discontinuity of a naive waveform, it rounds off the step
+// over the sample either side of it.
+
+static inline double PolyBlep(double t, double dt)
+{
+    if (t < dt)
+    {
+        t /= dt;
+        return t + t - t * t - 1.0;
+    }
+    if (t > 1.0 - dt)
+    {
+        t = (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+// Integral of the above, for the slope changes of a triangle.
+
+static inline double PolyBlamp(double t, double dt)
+{
+    if (t < dt)
+    {
+        t = t / dt - 1.0;
+        return -t * t * t / 3.0;
+    }
+    if (t > 1.0 - dt)
+    {
+        t = (t - 1.0) / dt + 1.0;
+        return t * t * t / 3.0;
+    }
+    return 0.0;
+}
+
+double Oscillator::BlepSample(double t, double dt) const
+{
+    switch (shape)
+    {
+        case kSawtooth:
+            return 1.0 - 2.0 * t + PolyBlep(t, dt);
+        case kRamp:
+            return 2.0 * t - 1.0 - PolyBlep(t, dt);
+        case kSquare:
+        {
+            double v = (t < 0.5) ? 1.0 : -1.0;
+            double h = t + 0.5;
+            if (h >= 1.0)
+                h -= 1.0;
+            return 0.95 * (v + PolyBlep(t, dt) - PolyBlep(h, dt));
+        }
+        case kTriangle:                         // corners at 1/4 and 3/4 get the integrated residual
+        {
+            double v    = (t < 0.25) ? 4.0 * t : (t < 0.75) ? 2.0 - 4.0 * t : 4.0 * t - 4.0;
+            double peak = t - 0.25, trough = t - 0.75;
+            if (peak < 0.0)
+                peak += 1.0;
+            if (trough < 0.0)
+                trough += 1.0;
+            return v + 4.0 * dt * (PolyBlamp(trough, dt) - PolyBlamp(peak, dt));
+        }
+        default:
+            return 0.0;
+    }
+}
+
+void Oscillator::RenderBLEP(PfxSample* out, int first, int end, int, double& idx, double inc, double di, double vol)
+{
+    double size  = tableSize;
+    double scale = 1.0 / size;
+
+    for (int j=first; j<end; j++)
+    {
+        out[j] = BlepSample(idx * scale, fabs(inc) * scale) * vol;
+
+        idx += inc;
+        inc += di;
+        while (idx >= size)
+            idx -= size;
+        while (idx < 0.0)
+            idx += size;
+    }
 }
 
-void Oscillator::Sample(int sNo)
+void Oscillator::RenderBLEPFixed(PfxSample* out, int first, int end, int, double&, double inc, double di, double vol)
+{
+    double   scale = 1.0 / tableSize;
+    uint64_t step  = ToFixed(inc), dstep = ToFixed(di);
+    uint32_t ph    = phase;
+
+    for (int j=first; j<end; j++)
+    {
+        out[j] = BlepSample(ldexp((double)ph, -32), fabs(inc) * scale) * vol;
+
+        ph   += (uint32_t)((step + 0x80000000ULL) >> 32);
+        step += dstep;
+        inc  += di;
+    }
+    phase = ph;
+}
+
+/*
+ Audio-rate modulation is laid out as two per-sample arrays before any
+ table is read: the FM deviation in table positions per sample and the PM
+ offset in table positions.  Both are built with vector kernels, so the
+ only serial work left per sample is the phase sum and the table read.
+ The glide's own increment stays in double and is added per piece.
+*/
+void Oscillator::BuildModulation(int first, int count)
+{
+    if ((int)modInc.size() < count)
+    {
+        modInc.resize(count);
+        modOffset.resize(count);
+    }
+
+    KernelZero(modInc.data(), count);
+    if (fmInput != nullptr)
+        KernelAccumulate(modInc.data(), fmInput->OutputSamples(0) + first, fmDepth * incPerHz, 0.0, count);
+
+    KernelZero(modOffset.data(), count);
+    if (pmInput != nullptr)
+        KernelAccumulate(modOffset.data(), pmInput->OutputSamples(0) + first, pmIndex / (2.0 * M_PI) * tableSize, 0.0, count);
+}
+
+// One glide piece [first, end) of a modulated block; 'mod' is the sample
+// of the block that 'first' corresponds to in the modulation arrays.
+
+template <bool fixed, bool blep, Interpolation::mode M>
+void Oscillator::RenderModulated(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol)
+{
+    const PfxSample* devs  = modInc.data() + mod;
+    const PfxSample* offs  = modOffset.data() + mod;
+    const int        n     = end - first;
+    const double     top   = fmax(fabs(inc), fabs(inc + di * n)) + KernelPeak(devs, n);
+    const PfxSample* tab   = levels[LevelFor(top)]->Samples();
+    const double     size  = tableSize, inv = 1.0 / size;
+    const int        shift = fixed ? phaseShift : 0;
+    const uint32_t   mask  = (uint32_t)((1ULL << shift) - 1);
+    const double     units = ldexp(1.0, shift);         // phase units per table position
+    const double     scale = ldexp(1.0, -shift);
+    uint32_t         ph    = phase;
+
+    for (int k=0; k<n; k++)
+    {
+        double step = inc + devs[k];
+        double v;
+
+        if (fixed)
+        {
+            uint32_t p = ph + (uint32_t)(int64_t)(offs[k] * units);
+            if (blep)
+                v = BlepSample(ldexp((double)p, -32), fabs(step) * inv);
+            else
+                v = Interpolator<M>::Read(tab, p >> shift, (p & mask) * scale);
+            ph += (uint32_t)llround(step * units);
+        }
+        else
+        {
+            double p = idx + offs[k];
+            p -= floor(p * inv) * size;
+            if (blep)
+                v = BlepSample(p * inv, fabs(step) * inv);
+            else
+            {
+                int i1 = (int)p;
+                v = Interpolator<M>::Read(tab, i1, p - i1);
+            }
+            idx += step;
+            idx -= floor(idx * inv) * size;
+        }
+        out[first + k] = v * vol;
+        inc += di;
+    }
+    if (fixed)
+        phase = ph;
+}
+
+template <Interpolation::mode M>
+Oscillator::pieceFun Oscillator::TableRenderer(bool fixedPhase, bool modulated)
+{
+    if (modulated)
+        return fixedPhase ? &Oscillator::RenderModulated<true, false, M> : &Oscillator::RenderModulated<false, false, M>;
+    return fixedPhase ? &Oscillator::RenderTableFixed<M> : &Oscillator::RenderTable<M>;
+}
+
+// Pick the piece renderer once per block: the phase form, PolyBLEP and
+// the interpolation are all template arguments, so nothing is tested
+// per sample.
+
+Oscillator::pieceFun Oscillator::Renderer(bool blep, bool fixedPhase, bool modulated) const
+{
+    if (blep)
+    {
+        if (modulated)
+            return fixedPhase ? &Oscillator::RenderModulated<true,  true, Interpolation::kLinear>
+                              : &Oscillator::RenderModulated<false, true, Interpolation::kLinear>;
+        return fixedPhase ? &Oscillator::RenderBLEPFixed : &Oscillator::RenderBLEP;
+    }
+    switch (interp)
+    {
+        case Interpolation::kTruncate: return TableRenderer<Interpolation::kTruncate>(fixedPhase, modulated);
+        case Interpolation::kHermite:  return TableRenderer<Interpolation::kHermite> (fixedPhase, modulated);
+        case Interpolation::kLagrange: return TableRenderer<Interpolation::kLagrange>(fixedPhase, modulated);
+        default:                       return TableRenderer<Interpolation::kLinear>  (fixedPhase, modulated);
+    }
+}
+
+void Oscillator::Process(int first, int count)
 {
     if (!active || tableSize == 0.0)
         return;
+    if (EnvelopeDone())                         // note has released: nothing to render
+    {
+        KernelZero(outputSamples[0]+first, count);
+        return;
+    }
 
-    double pt1    = table[(int)index];
-    double i2     = index+1.0;
-    if (i2 >= tableSize)
-        i2 -= tableSize;
-    double pt2    = table[(int)i2];
-    double output = pt1 + ((index - ((int)index)) * (pt2 - pt1));
+    PfxSample* out        = outputSamples[0];
+    double     idx        = index;
+    double     vol        = volume.Value();
+    bool       blep       = (mode == kPolyBLEP) && shape != kSine && shape != kTest;
+    bool       fixedPhase = (phasing == kFixedPhase) && phaseShift > 0;
+    bool       modulated  = (fmInput != nullptr || pmInput != nullptr);
+    int        j          = first, last = first + count;
 
-    index += increment;
+    if (modulated)
+        BuildModulation(first, count);
+    pieceFun render = Renderer(blep, fixedPhase, modulated);
 
-    while (index >= tableSize)
-        index -= tableSize;
-    while (index < 0.0)
-        index += tableSize;
-    
-    if (usingEnvelope)
+    while (j < last)                            // one pass per linear piece of the frequency glide
     {
-        env->Sample(sNo);
-        output *= env->GetSample(sNo);
+        double   f, df;
+        unsigned n   = frequency.Segment(last - j, f, df);
+        double   inc = f  * incPerHz;
+        double   di  = df * incPerHz;
+
+        (this->*render)(out, j, j + n, j - first, idx, inc, di, vol);
+        j += n;
+    }
+    if (fixedPhase)                             // keep the other form in step, so switching modes does not jump
+        index = ldexp((double)phase, -32) * tableSize;
+    else
+    {
+        index = idx;
+        phase = (uint32_t)(int64_t)ldexp(idx / tableSize, 32);
     }
 
-    outputSamples[0][sNo] = output * volume;
+    if (usingEnvelope)
+        ApplyEnvelope(first, count);
 }
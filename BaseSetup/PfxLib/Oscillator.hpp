@@ -7,31 +7,83 @@
 #define Oscillator_hpp
 
 #include "Instrument.hpp"
+#include "WavetableCache.hpp"
+#include "Interpolators.hpp"
+#include <cstdint>
+#include <vector>
 
 class Oscillator : public Instrument
 {
 public:
-    enum tableType { kSine, kSawtooth, kSquare, kRamp, kTriangle, kTest };
+    enum tableType  { kSine     = Wavetable::kSine,     kSawtooth = Wavetable::kSawtooth,
+                      kSquare   = Wavetable::kSquare,   kRamp     = Wavetable::kRamp,
+                      kTriangle = Wavetable::kTriangle, kTest     = Wavetable::kTest };
+    enum renderMode { kWavetable, kPolyBLEP };  // mipmapped table lookup, or naive shape + PolyBLEP correction
+    enum phaseMode  { kFloatPhase, kFixedPhase };   // double table index, or 32-bit phase accumulator (power-of-two tables)
 
 private:
-    double  frequency;
-    double  increment;
-    double  index;
-    double  tableSize;
-    double* table;
+    SmoothedValue frequency;                    // Hz; glides when SetGlide has been given a time
+    double     incPerHz;                        // table positions per sample for each Hz
+    double     index;
+    uint32_t   phase;                           // kFixedPhase: a full cycle is 2^32
+    int        phaseShift;                      // 32 - log2(tableSize): phase >> phaseShift is the table index; -1 if not a power of two
+    phaseMode  phasing;
+    double     tableSize;
+    const PfxSample* table;                     // level 0, full bandwidth
+    shared_ptr<const Wavetable> levels[Wavetable::kMaxLevels];  // from WavetableCache; one per octave for band-limited shapes
+    int        numLevels;
+    tableType  shape;
+    renderMode mode;
+    Interpolation::mode interp;                 // how table reads are interpolated
+    Unit*      fmInput;                         // channel 0 adds fmDepth Hz per unit to the frequency, per sample
+    double     fmDepth;
+    Unit*      pmInput;                         // channel 0 offsets the phase by pmIndex radians per unit, per sample
+    double     pmIndex;
+    vector<PfxSample> modInc;                   // per-sample FM deviation, in table positions per sample
+    vector<PfxSample> modOffset;                // per-sample PM offsets, in table positions
+
+    int      LevelFor(double inc) const;
+    double   BlepSample(double t, double dt) const;
+    /* piece renderers: samples [first, end) of the block, 'mod' samples into it; all share one signature */
+    typedef void (Oscillator::*pieceFun)(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    template <Interpolation::mode M>
+    void     RenderTable(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    template <Interpolation::mode M>
+    void     RenderTableFixed(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    void     RenderBLEP(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    void     RenderBLEPFixed(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    int64_t  ToFixed(double positions) const;   // table positions -> Q32.32 phase units
+    void     BuildModulation(int first, int count);
+    template <bool fixed, bool blep, Interpolation::mode M>
+    void     RenderModulated(PfxSample* out, int first, int end, int mod, double& idx, double inc, double di, double vol);
+    template <Interpolation::mode M>
+    static pieceFun TableRenderer(bool fixedPhase, bool modulated);
+    pieceFun Renderer(bool blep, bool fixedPhase, bool modulated) const;
 
 public:
              Oscillator(void);
+             Oscillator(AudioContext& ctx);
     virtual ~Oscillator(void);
 
     void     ComputeTableSamples(tableType type);
     void     FillTable(tableType type, long size);
     void     FillTable(tableType type);
+    double   GetFreq(void) const { return frequency.Current(); }
+    int      Inputs(Unit** in, int max) const override;     // the input Unit plus any FM/PM sources
+    renderMode GetMode(void) const { return mode; }
+    void     SetMode(renderMode m) { mode = m; }
+    Interpolation::mode GetInterpolation(void) const { return interp; }
+    void     SetInterpolation(Interpolation::mode m) { interp = m; }
+    phaseMode GetPhaseMode(void) const { return phasing; }
+    void     SetPhaseMode(phaseMode m) { phasing = m; }    // kFixedPhase falls back to kFloatPhase for other table sizes
     void     SetFreq(double freq)             override;
+    void     SetGlide(double ms, SmoothedValue::smoothMode m = SmoothedValue::kExponential);   // portamento time for SetFreq
     void     SetFreq(int pitch)               override;
+    void     SetFrequencyModulation(Unit* src, double hzPerUnit);   // audio-rate FM from 'src'; nullptr removes it
+    void     SetPhaseModulation(Unit* src, double radiansPerUnit);  // audio-rate PM from 'src'; nullptr removes it
     void     TurnOn(double freq=440.0)        override;
     void     TurnOn(double freq, double rate) override;
-    void     Sample(int sNo)                  override;
-    void     ZeroPhase(void) { index = 0; }
+    void     Process(int first, int count)    override;
+    void     ZeroPhase(void) { index = 0; phase = 0; }
 };
 #endif /* Oscillator_hpp */
@@ -0,0 +1,167 @@
+//
+//  OscillatorBank.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "OscillatorBank.hpp"
+#include "MixKernels.hpp"
+#include "Simd.hpp"
+#include <math.h>
+
+typedef SimdVec<PfxSample> S;
+
+OscillatorBank::OscillatorBank(int count) : OscillatorBank(AudioContext::Default(), count) {}
+
+OscillatorBank::OscillatorBank(AudioContext& ctx, int count) : Unit(ctx, kMono)
+{
+    const int W = S::kWidth;
+
+    partials = (count > 0) ? count : 0;
+    padded   = (partials + W - 1) / W * W;
+    for (vector<PfxSample>* v : { &phase, &inc, &incStep, &incLo, &incHi, &amp, &ampStep, &ampLo, &ampHi })
+        v->assign(padded, PfxSample(0));
+    acc.assign(bufferSize * W, PfxSample(0));
+}
+
+double OscillatorBank::GetFrequency(int i) const
+{
+    if (i < 0 || i >= partials) return 0.0;
+    return inc[i] * samplingRate;
+}
+
+double OscillatorBank::GetAmplitude(int i) const
+{
+    if (i < 0 || i >= partials) return 0.0;
+    return amp[i];
+}
+
+// Start a linear ramp of 'value[i]' to 'target' over 'ms'.  The step keeps
+// being added once the ramp arrives, but the clamp range pins it there.
+
+void OscillatorBank::Ramp(vector<PfxSample>& value, vector<PfxSample>& step, vector<PfxSample>& lo,
+                          vector<PfxSample>& hi, int i, double target, double ms)
+{
+    double samples = MsToSamples(ms);
+    double from    = value[i];
+
+    if (samples < 1.0)
+    {
+        value[i] = target;
+        step [i] = 0.0;
+        lo   [i] = hi[i] = target;
+        return;
+    }
+    step[i] = (target - from) / samples;
+    lo  [i] = fmin(from, target);
+    hi  [i] = fmax(from, target);
+}
+
+void OscillatorBank::SetPartial(int i, double freq, double gain)
+{
+    SetFrequency(i, freq);
+    SetAmplitude(i, gain);
+}
+
+void OscillatorBank::SetFrequency(int i, double freq, double ms)
+{
+    if (i < 0 || i >= partials) return;
+    double cycles = fmin(fmax(freq / samplingRate, 0.0), 0.5);
+    Ramp(inc, incStep, incLo, incHi, i, cycles, ms);
+}
+
+void OscillatorBank::SetAmplitude(int i, double gain, double ms)
+{
+    if (i < 0 || i >= partials) return;
+    Ramp(amp, ampStep, ampLo, ampHi, i, gain, ms);
+    if (gain != 0.0)
+        Wake();
+}
+
+void OscillatorBank::SetPhase(int i, double cycles)
+{
+    if (i < 0 || i >= partials) return;
+    cycles -= floor(cycles);
+    phase[i] = (cycles >= 0.75) ? cycles - 1.0 : cycles;
+}
+
+bool OscillatorBank::Idle(void) const
+{
+    for (int i=0; i<partials; i++)
+    {
+        double target = (ampStep[i] > 0.0) ? ampHi[i] : ampLo[i];
+        if (amp[i] != 0.0 || (ampStep[i] != 0.0 && target != 0.0))
+            return false;
+    }
+    return true;
+}
+
+// sin(2 pi r) for r in [-0.25, 0.25]: Taylor series in x = 2 pi r to x^9.
+
+static inline S::V SinQuarter(S::V r)
+{
+    const S::V twoPi = S::Set(PfxSample(2.0 * M_PI));
+    const S::V c3 = S::Set(PfxSample(-1.0 / 6.0));
+    const S::V c5 = S::Set(PfxSample( 1.0 / 120.0));
+    const S::V c7 = S::Set(PfxSample(-1.0 / 5040.0));
+    const S::V c9 = S::Set(PfxSample( 1.0 / 362880.0));
+    S::V x  = S::Mul(r, twoPi);
+    S::V x2 = S::Mul(x, x);
+    S::V p  = S::Add(c7, S::Mul(x2, c9));
+    p = S::Add(c5, S::Mul(x2, p));
+    p = S::Add(c3, S::Mul(x2, p));
+    p = S::Add(S::Set(PfxSample(1)), S::Mul(x2, p));
+    return S::Mul(x, p);
+}
+
+/*
+ Each group of kWidth partials runs the whole block with its state in
+ registers, adding its lanes into acc (one vector per sample).  The lanes
+ are summed into the output once at the end, so the cost of the horizontal
+ add is paid per sample rather than per partial.
+*/
+void OscillatorBank::Process(int first, int count)
+{
+    if (!active) return;
+    if (first + count > (int)bufferSize)
+        count = (int)bufferSize - first;        // acc holds one block; never grow it here
+
+    const int  W       = S::kWidth;
+    const S::V one     = S::Set(PfxSample(1));
+    const S::V quarter = S::Set(PfxSample(0.25));
+    const S::V wrapAt  = S::Set(PfxSample(0.75));
+    PfxSample* sums    = acc.data();
+
+    KernelZero(sums, count * W);
+    for (int g=0; g<padded; g+=W)
+    {
+        S::V p  = S::Load(&phase[g]);
+        S::V f  = S::Load(&inc[g]),  df = S::Load(&incStep[g]);
+        S::V fl = S::Load(&incLo[g]), fh = S::Load(&incHi[g]);
+        S::V a  = S::Load(&amp[g]),  da = S::Load(&ampStep[g]);
+        S::V al = S::Load(&ampLo[g]), ah = S::Load(&ampHi[g]);
+
+        for (int j=0; j<count; j++)
+        {
+            S::V r = S::Sub(quarter, S::Abs(S::Sub(p, quarter)));     // fold onto the quarter wave
+            S::Store(sums + j*W, S::Add(S::Load(sums + j*W), S::Mul(SinQuarter(r), a)));
+
+            p = S::Add(p, f);
+            p = S::Sub(p, S::And(S::Less(wrapAt, p), one));
+            f = S::Min(fh, S::Max(fl, S::Add(f, df)));
+            a = S::Min(ah, S::Max(al, S::Add(a, da)));
+        }
+        S::Store(&phase[g], p);
+        S::Store(&inc[g],   f);
+        S::Store(&amp[g],   a);
+    }
+
+    PfxSample* out = outputSamples[0] + first;
+    PfxSample  vol = volume.Value();
+    for (int j=0; j<count; j++)
+    {
+        PfxSample sum = 0;
+        for (int l=0; l<W; l++)
+            sum += sums[j*W + l];
+        out[j] = sum * vol;
+    }
+}
@@ -0,0 +1,51 @@
+//
+//  OscillatorBank.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Many sine partials rendered by one Unit into one mono buffer, for
+//  additive synthesis.  Per-partial state lives in structure-of-arrays
+//  form (phase, increment, amplitude and their ramps), padded to the SIMD
+//  width, so Process runs kWidth partials per vector operation and keeps
+//  each group's state in registers for the whole block.  There is no
+//  envelope or per-partial virtual call; shape the sound with the
+//  amplitude ramps and the Unit's volume.
+//
+//  Phase is held in cycles on [-0.25, 0.75) and the sine is an odd
+//  polynomial on the folded quarter wave (error below 4e-6).  Frequencies
+//  are clamped to [0, Nyquist].  Ramps are linear and stop at their
+//  target.  Setters write the arrays directly, so call them from the
+//  thread that runs the Score or between blocks, as with other Units.
+//
+
+#pragma once
+
+#include "Unit.hpp"
+#include <vector>
+using namespace std;
+
+class OscillatorBank : public Unit
+{
+    int                partials;                // partials in use
+    int                padded;                  // partials rounded up to the SIMD width
+    vector<PfxSample>  phase;                   // cycles, [-0.25, 0.75)
+    vector<PfxSample>  inc, incStep, incLo, incHi;      // cycles per sample, its ramp step and clamp range
+    vector<PfxSample>  amp, ampStep, ampLo, ampHi;      // linear gain, its ramp step and clamp range
+    vector<PfxSample>  acc;                     // bufferSize vectors of per-lane partial sums
+
+    void    Ramp(vector<PfxSample>& value, vector<PfxSample>& step, vector<PfxSample>& lo,
+                 vector<PfxSample>& hi, int i, double target, double ms);
+
+public:
+            OscillatorBank(int count);
+            OscillatorBank(AudioContext& ctx, int count);
+
+    int     Partials(void) const            { return partials; }
+    double  GetFrequency(int i) const;
+    double  GetAmplitude(int i) const;
+    void    SetPartial(int i, double freq, double gain);            // jump straight to a frequency and amplitude
+    void    SetFrequency(int i, double freq, double ms = 0.0);      // glide to 'freq' over 'ms'
+    void    SetAmplitude(int i, double gain, double ms = 0.0);      // ramp to 'gain' over 'ms'
+    void    SetPhase(int i, double cycles);
+    bool    Idle(void) const override;      // every amplitude is and will stay zero
+    void    Process(int first, int count) override;
+};
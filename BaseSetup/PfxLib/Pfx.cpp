@@ -1,6 +1,7 @@
 #include "Pfx.hpp"
+#include "RealtimeThreads.hpp"
 
-Pfx::Pfx(void) : score(nullptr), playing(false), mInputBuffer(nullptr), inputBuffer(nullptr)
+Pfx::Pfx(AudioContext& ctx) : playing(false), mInputBuffer(nullptr), context(&ctx), arena(nullptr), numMixChannels(0), inputBuffer(nullptr), score(nullptr)
 {
     OSStatus err = Init(kAudioDeviceUnknown, kAudioDeviceUnknown);
     
@@ -11,7 +12,7 @@ Pfx::Pfx(void) : score(nullptr), playing(false), mInputBuffer(nullptr), inputBuf
     }
 }
 
-Pfx::Pfx(AudioDeviceID input, AudioDeviceID output) : score(nullptr), playing(false), mInputBuffer(nullptr), inputBuffer(nullptr)
+Pfx::Pfx(AudioDeviceID input, AudioDeviceID output, AudioContext& ctx) : playing(false), mInputBuffer(nullptr), context(&ctx), arena(nullptr), numMixChannels(0), inputBuffer(nullptr), score(nullptr)
 {
     OSStatus err = Init(input, output);
     
@@ -49,13 +50,7 @@ void Pfx::Cleanup(void)
 	Stop();
 									
     UInt32 i;
-    if (inputBuffer)
-    {
-        for (i=0; i<inBufferChannels; i++)
-            delete [] inputBuffer[i];
-        delete [] inputBuffer;
-        inputBuffer = nullptr;
-    }
+    FreeBlockBuffers();
 
 	if (mInputBuffer)
     {
@@ -65,15 +60,34 @@ void Pfx::Cleanup(void)
 		mInputBuffer = 0;
 	}
 	
-    for (i=0; i<kNumChans; i++)
-        delete [] mixChannels[i];
-
 	AUGraphClose  (mGraph);
 	DisposeAUGraph(mGraph);
     AudioUnitUninitialize        (mInputUnit);
     AudioComponentInstanceDispose(mInputUnit);
 }
 
+void Pfx::SetScore(Score* s)
+{
+    if (&s->Context() != context)
+    {
+        printf("score and pfx use different audio contexts");
+        exit(1);
+    }
+    score = s;
+    score->SetMixChans(numMixChannels);
+
+    // pool helpers join the output unit's workgroup as they start, so restart any the Score already has
+    if (__builtin_available(macOS 11.0, *))
+    {
+        os_workgroup_t workgroup = nullptr;
+        UInt32         size      = sizeof(workgroup);
+        if (AudioUnitGetProperty(mOutputUnit, kAudioOutputUnitProperty_OSWorkgroup, kAudioUnitScope_Global, 0, &workgroup, &size) == noErr)
+            SetAudioWorkgroup(workgroup);
+    }
+    if (score->NumThreads() > 1)
+        score->SetNumThreads(score->NumThreads());
+}
+
 OSStatus Pfx::Start(void)
 {
 	OSStatus err = noErr;
@@ -112,8 +126,8 @@ OSStatus Pfx::Stop(void)
 
 void Pfx::RouteAudio(void)
 {
-    for (int i=0; i<kNumChans; i++)
-        for (int j=0; j<samplesPerChannel; j++)
+    for (UInt32 i=0; i<numMixChannels; i++)
+        for (unsigned j=0; j<context->BufferSize(); j++)
             mixChannels[i][j] = 0.0;
     
     if ((score == nullptr) || (!playing)) return;
@@ -297,11 +311,15 @@ OSStatus Pfx::SetupBuffers(void)
 	err = AudioUnitGetProperty(mInputUnit, kAudioDevicePropertyBufferFrameSize, kAudioUnitScope_Global, 0, &samplesPerChannel, &propertySize);
     checkErr(err);
 
-    Unit::SetBufferSize(samplesPerChannel);
-    AllocateInputBuffer();
+    /* a callback may bring more than the nominal size; the input unit's slice limit bounds it */
+    propertySize = sizeof(maxFrames);
+    if (AudioUnitGetProperty(mInputUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFrames, &propertySize) != noErr)
+        maxFrames = 0;
+    if (maxFrames < samplesPerChannel)
+        maxFrames = samplesPerChannel;
 
     /* channelwise buffer size in bytes, assuming Float32 samples */
-    bufferSizeBytes = samplesPerChannel * sizeof(Float32);
+    bufferSizeBytes = maxFrames * sizeof(Float32);
 
     /* get sampling rate from input device */
     theAddress   = { kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
@@ -310,7 +328,7 @@ OSStatus Pfx::SetupBuffers(void)
     err          = AudioObjectGetPropertyData(inputDeviceID, &theAddress, 0, nullptr, &propertySize, &rate);
 	checkErr(err);
     
-    Unit::SetSampleRate(rate);
+    context->SetSampleRate(rate);
 
     /* get stream format of output bus on input unit */
     propertySize = sizeof(asbd);
@@ -333,7 +351,7 @@ OSStatus Pfx::SetupBuffers(void)
     numOutputChannels = asbdOutput.mChannelsPerFrame;
     
     /* make sure output sampling rate matches input */
-    rate = Unit::GetSamplingRate();
+    rate = context->SamplingRate();
     if (asbdOutput.mSampleRate != rate)
     {
         propertySize = sizeof(Float64);
@@ -349,21 +367,17 @@ OSStatus Pfx::SetupBuffers(void)
 	err          = AudioUnitSetProperty(mOutputUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, 0, &asbd, propertySize);
 	checkErr(err);
 
-    /* allocate and zero out mixChannels */
-    UInt32 i, j;
-    for (i=0; i<kNumChans; i++)
-    {
-        mixChannels[i] = new double[samplesPerChannel];
-        for (j=0; j<samplesPerChannel; j++)
-            mixChannels[i][j] = 0.0;
-    }
+    /* the graph runs at the device's block size unless SetBlockSize picks another */
+    context->SetBufferSize(samplesPerChannel);
+    context->CreateArena(AudioContext::kArenaUnits);
+    AllocateBlockBuffers();
 
     /* allocate and zero out mInputBuffer */
     propertySize = offsetof(AudioBufferList, mBuffers[0]) + (sizeof(AudioBuffer) * numInputChannels);
 	mInputBuffer = (AudioBufferList *)malloc(propertySize);
 	mInputBuffer->mNumberBuffers = numInputChannels;
 	
-	for (i=0; i<numInputChannels; i++)
+	for (UInt32 i=0; i<numInputChannels; i++)
     {
 		mInputBuffer->mBuffers[i].mNumberChannels = 1;
 		mInputBuffer->mBuffers[i].mDataByteSize   = bufferSizeBytes;
@@ -375,73 +389,120 @@ OSStatus Pfx::SetupBuffers(void)
     return err;
 }
 
+/*
+ Everything sized by the block the graph renders: the mix buffers (taken
+ from the arena, next to the Units' buffers), the graph's input block, and
+ the adapter between them and the device.
+*/
+void Pfx::AllocateBlockBuffers(void)
+{
+    arena          = context->Arena();
+    numMixChannels = numOutputChannels;
+    if (numMixChannels > Unit::kMaxChans) numMixChannels = Unit::kMaxChans;
+    for (UInt32 i=0; i<numMixChannels; i++)
+        mixChannels[i] = arena->Allocate();
+
+    AllocateInputBuffer();
+    adapter.Configure(context->BufferSize(), mixChannels, numMixChannels, inputBuffer, inBufferChannels, maxFrames);
+    adapter.SetRender(RenderBlock, this);
+}
+
+void Pfx::FreeBlockBuffers(void)
+{
+    UInt32 i;
+    if (inputBuffer)
+    {
+        for (i=0; i<inBufferChannels; i++)
+            delete [] inputBuffer[i];
+        delete [] inputBuffer;
+        inputBuffer = nullptr;
+    }
+
+    if (arena)
+    {
+        for (i=0; i<numMixChannels; i++)
+            arena->Release(mixChannels[i]);
+        arena = nullptr;
+    }
+}
+
+void Pfx::SetBlockSize(UInt32 frames)
+{
+    if (playing || (frames == 0)) return;
+
+    FreeBlockBuffers();
+    context->SetBufferSize(frames);
+    context->CreateArena(AudioContext::kArenaUnits);
+    AllocateBlockBuffers();
+    if (score != nullptr)
+        score->SetMixChans(numMixChannels);
+}
+
 void Pfx::AllocateInputBuffer(void)
 {
-    UInt32 i, j;
+    UInt32 i, j, frames = context->BufferSize();
     if (numInputChannels == 0)  { printf("no channels for input buffer"); exit(1); }
     inBufferChannels = numInputChannels;
     if (inBufferChannels > Unit::kMaxChans) inBufferChannels = Unit::kMaxChans;
     inputBuffer = new Float32*[inBufferChannels];
     for (i=0; i<inBufferChannels; i++)
         inputBuffer[i] = nullptr;
-    if (samplesPerChannel == 0) { printf("no frames for input buffer");   exit(1); }
+    if (frames == 0) { printf("no frames for input buffer");   exit(1); }
     for (i=0; i<inBufferChannels; i++)
     {
-        inputBuffer[i] = new Float32[samplesPerChannel];
-        for (j=0; j<samplesPerChannel; j++)
+        inputBuffer[i] = new Float32[frames];
+        for (j=0; j<frames; j++)
             inputBuffer[i][j] = 0.0;
     }
 }
 
-void Pfx::FillInputBuffer(AudioBufferList* a)
+void Pfx::RenderBlock(void* pfx)
 {
-    if (!inputBuffer) return;
-    unsigned chs = numInputChannels;
-    if (chs > Unit::kMaxChans) chs = Unit::kMaxChans;
-
-    for (UInt32 i=0; i<chs; i++)
-    {
-        Float32* store  = inputBuffer[i];
-        Float32* source = (Float32*)a->mBuffers[i].mData;
-        for (UInt32 j=0; j<samplesPerChannel; j++)
-            store[j] = source[j];
-    }
+    static_cast<Pfx*>(pfx)->RouteAudio();
 }
 
+static const UInt32 kMaxHostBuffers = 64;      // device channels the callbacks pass through; any more stay silent
+
 OSStatus Pfx::InputProc(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags,
                         const AudioTimeStamp* inTimeStamp, UInt32 inBusNumber,
                         UInt32 inNumberFrames, AudioBufferList* ioData)
 {
     OSStatus err  = noErr;
-	Pfx*     This = (Pfx *)inRefCon;
-		
-	err = AudioUnitRender(This->mInputUnit, ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames, This->mInputBuffer);
-	checkErr(err);
-    
-    This->FillInputBuffer(This->mInputBuffer);
-    
-	return err;
+    Pfx*     This = (Pfx *)inRefCon;
+    UInt32   i, chans = This->mInputBuffer->mNumberBuffers;
+
+    if (inNumberFrames > This->maxFrames)
+        inNumberFrames = This->maxFrames;
+    for (i=0; i<chans; i++)
+        This->mInputBuffer->mBuffers[i].mDataByteSize = inNumberFrames * sizeof(Float32);
+
+    err = AudioUnitRender(This->mInputUnit, ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames, This->mInputBuffer);
+    checkErr(err);
+
+    const Float32* in[kMaxHostBuffers];
+    if (chans > kMaxHostBuffers) chans = kMaxHostBuffers;
+    for (i=0; i<chans; i++)
+        in[i] = (const Float32*)This->mInputBuffer->mBuffers[i].mData;
+    This->adapter.Write(in, chans, inNumberFrames);
+
+    return err;
 }
 
+/* one non-interleaved buffer per device channel, filled from as many fixed-size blocks as it takes */
 OSStatus Pfx::OutputProc(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags,
                     const AudioTimeStamp* TimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames,
                     AudioBufferList* ioData)
 {
-    Pfx *This = (Pfx *)inRefCon;
-    
-    Float32* left  = (Float32*)ioData->mBuffers[0].mData;
-    Float32* right = (Float32*)ioData->mBuffers[1].mData;
-    
-    This->RouteAudio();
-    double** m    = This->GetMixChannels();
-    double*  mixL = m[0];
-    double*  mixR = m[1];
-    
-    for (UInt32 frame=0; frame<inNumberFrames; frame++)
-    {
-        left [frame] = (Float32)(mixL[frame]);
-        right[frame] = (Float32)(mixR[frame]);
-    }
+    Pfx*     This  = (Pfx *)inRefCon;
+    UInt32   chans = ioData->mNumberBuffers;
+    Float32* out[kMaxHostBuffers];
+
+    for (UInt32 c=kMaxHostBuffers; c<chans; c++)
+        memset(ioData->mBuffers[c].mData, 0, ioData->mBuffers[c].mDataByteSize);
+    if (chans > kMaxHostBuffers) chans = kMaxHostBuffers;
+    for (UInt32 c=0; c<chans; c++)
+        out[c] = (Float32*)ioData->mBuffers[c].mData;
+
+    This->adapter.Read(out, chans, inNumberFrames);
     return noErr;
 }
-
@@ -5,6 +5,8 @@
 #include <AudioToolbox/AudioToolbox.h>
 #include <AudioUnit/AudioUnit.h>
 #include "Score.hpp"
+#include "BufferArena.hpp"
+#include "BlockAdapter.hpp"
 
 #define checkErr( err) \
 if(err) {\
@@ -33,42 +35,52 @@ private:
     AUNode              mOutputNode;
     AudioUnit           mOutputUnit;
     
-    double*             mixChannels[kNumChans];
+    AudioContext*       context;                // rate, block size and arena the device is run at
+    BlockAdapter        adapter;                // host callback size <-> context block size
+    BufferArena*        arena;
+    PfxSample*          mixChannels[Unit::kMaxChans];
+    UInt32              numMixChannels;         // device output channels we mix, at most Unit::kMaxChans
     Float32**           inputBuffer;
-    UInt32              samplesPerChannel;
+    UInt32              samplesPerChannel;      // the device's nominal callback size
+    UInt32              maxFrames;              // the most frames one callback may bring
     UInt32              numInputChannels;
     UInt32              inBufferChannels;
     UInt32              numOutputChannels;
     Score*              score;
     
 public:
-    Pfx(void);
-    Pfx(AudioDeviceID input, AudioDeviceID output);
+    Pfx(AudioContext& ctx = AudioContext::Default());
+    Pfx(AudioDeviceID input, AudioDeviceID output, AudioContext& ctx = AudioContext::Default());
     ~Pfx(void);
     
     void		Cleanup(void);
     OSStatus	Init(AudioDeviceID input, AudioDeviceID output);
+    AudioContext& Context(void)            const { return *context;              }   // build the Score and its Units in this
     UInt32      GetInBufferChannels(void)  const { return inBufferChannels;      }
-    double**    GetMixChannels(void)       const { return (double**)mixChannels; }
+    PfxSample** GetMixChannels(void)       const { return (PfxSample**)mixChannels; }
+    UInt32      GetNumMixChannels(void)    const { return numMixChannels;        }
     UInt32      GetNumInputChannels (void) const { return numInputChannels;      }
     Float32**   GetInputBuffer(void)       const { return inputBuffer;           }
     UInt32      GetSamplesPerChannel(void) const { return samplesPerChannel;     }
     OSStatus	SetInputDeviceAsCurrent (AudioDeviceID in );
     OSStatus	SetOutputDeviceAsCurrent(AudioDeviceID out);
-    void        SetScore(Score* s) { score = s; }
+    void        SetBlockSize(UInt32 frames);    // render the graph in blocks of 'frames'; call while stopped, before building the Score
+    void        SetScore(Score* s);             // 's' must have been built in this Pfx's context
     OSStatus	Start(void);
     OSStatus	Stop(void);
     
 private:
     OSStatus    AddOutputNodeAndUnit(void);
+    void        AllocateBlockBuffers(void);
     void        AllocateInputBuffer(void);
+    void        FreeBlockBuffers(void);
     OSStatus    SetupGraph(AudioDeviceID out);
     
     OSStatus    BuildInputUnit(AudioDeviceID in);
     OSStatus    EnableInput(void);
     OSStatus    InputCallbackSetup();
-    void        FillInputBuffer(AudioBufferList* a);
     void        RouteAudio(void);
+    static void RenderBlock(void* pfx);
     OSStatus    SetupBuffers(void);
     
     
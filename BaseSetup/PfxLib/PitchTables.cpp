@@ -0,0 +1,175 @@
+//
+//  PitchTables.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "PitchTables.hpp"
+#include <array>
+#include <math.h>
+using namespace std;
+
+/*
+ constexpr 2^x: whole octaves by doubling, the fraction by the Taylor
+ series of e^(f ln 2), which for |f ln 2| < 0.7 reaches double precision
+ well inside 30 terms.
+*/
+static constexpr double kLn2 = 0.693147180559945309417232121458;
+
+static constexpr double ConstExp2(double x)
+{
+    int    whole = static_cast<int>(x);
+    double frac  = x - whole;
+    double r     = 1.0, term = 1.0;
+
+    for (int k=1; k<30; k++)
+    {
+        term *= frac * kLn2 / k;
+        r    += term;
+    }
+    for (; whole>0; whole--) r *= 2.0;
+    for (; whole<0; whole++) r *= 0.5;
+    return r;
+}
+
+static constexpr int kCents = 100;
+
+static constexpr array<double, PitchTables::kNumPitches> BuildMidi(void)
+{
+    array<double, PitchTables::kNumPitches> t {};
+    for (int i=0; i<PitchTables::kNumPitches; i++)
+        t[i] = PitchTables::kA4 * ConstExp2((i - 69) / 12.0);
+    return t;
+}
+
+static constexpr array<double, kCents+1> BuildCents(void)
+{
+    array<double, kCents+1> t {};
+    for (int i=0; i<=kCents; i++)
+        t[i] = ConstExp2(i / 1200.0);
+    return t;
+}
+
+static constexpr array<double, PitchTables::kNumPitches> BuildBoundaries(void)    // [i] = lowest frequency that rounds to pitch i
+{
+    array<double, PitchTables::kNumPitches> t {};
+    for (int i=0; i<PitchTables::kNumPitches; i++)
+        t[i] = PitchTables::kA4 * ConstExp2((i - 69.5) / 12.0);
+    return t;
+}
+
+static constexpr array<double, PitchTables::kNumPitches> midiFreq   = BuildMidi();
+static constexpr array<double, kCents+1>                 centRatio  = BuildCents();
+static constexpr array<double, PitchTables::kNumPitches> boundaries = BuildBoundaries();
+
+static_assert(midiFreq[69] == 440.0, "A4 must be exact");
+
+/*
+ Within a cent the ratio is centRatio[ci] * 2^(frac/1200); the cubic
+ Taylor series of that last factor leaves an error near 5e-15 where a
+ straight line between table entries would leave 4e-8.
+*/
+static inline double CentRatio(int ci, double frac)
+{
+    double u = frac * (kLn2 / 1200.0);
+    return centRatio[ci] * (1.0 + u * (1.0 + u * (0.5 + u * (1.0 / 6.0))));
+}
+
+double PitchTables::MidiToFrequency(int pitch)
+{
+    if (pitch < 0)            pitch = 0;
+    if (pitch >= kNumPitches) pitch = kNumPitches-1;
+    return midiFreq[pitch];
+}
+
+double PitchTables::CentsToRatio(double cents)
+{
+    double octaves = floor(cents / 1200.0);
+    double within  = cents - octaves * 1200.0;      // 0 <= within < 1200
+    int    semis   = static_cast<int>(within / 100.0);
+    double c       = within - semis * 100.0;
+    int    ci      = static_cast<int>(c);
+    double ratio   = midiFreq[60 + semis] / midiFreq[60];
+
+    if (ci >= kCents) ci = kCents-1;
+    ratio *= CentRatio(ci, c - ci);
+    return ldexp(ratio, static_cast<int>(octaves));
+}
+
+double PitchTables::MidiToFrequency(double pitch)
+{
+    if (pitch <= 0.0)               return midiFreq[0];
+    if (pitch >= kNumPitches - 1)   return midiFreq[kNumPitches-1];
+
+    int    whole = static_cast<int>(pitch);
+    double c     = (pitch - whole) * kCents;
+    int    ci    = static_cast<int>(c);
+    return midiFreq[whole] * CentRatio(ci, c - ci);
+}
+
+int PitchTables::FrequencyToMidi(double freq)
+{
+    int lo = 0, hi = kNumPitches-1;                 // last boundary <= freq
+
+    if (freq < boundaries[1]) return 0;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (boundaries[mid] <= freq) lo = mid;
+        else                         hi = mid-1;
+    }
+    return lo;
+}
+
+/* nearest pitch by table, then how many cents above or below it by searching the cent ratios */
+double PitchTables::FrequencyToPitch(double freq)
+{
+    if (freq <= midiFreq[0])             return 0.0;
+    if (freq >= midiFreq[kNumPitches-1]) return kNumPitches-1;
+
+    int    base  = FrequencyToMidi(freq);
+    if (freq < midiFreq[base]) base--;              // interpolate upward from the note below
+    double ratio = freq / midiFreq[base];
+    int    lo = 0, hi = kCents;
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if (centRatio[mid] <= ratio) lo = mid;
+        else                         hi = mid;
+    }
+    double c = lo + (ratio - centRatio[lo]) / (centRatio[hi] - centRatio[lo]);
+    return base + c / kCents;
+}
+
+VelocityCurve::VelocityCurve(curveType t, double s)
+{
+    Set(t, s);
+}
+
+/*
+ kPower:   (v/127)^shape; shape 2 is the curve Unit has always used
+ kDecibel: 'shape' dB of range, velocity 127 at 0 dB and linear in dB below
+*/
+void VelocityCurve::Set(curveType t, double s)
+{
+    type  = t;
+    shape = s;
+    amplitude[0] = 0.0;
+    for (int v=1; v<PitchTables::kNumPitches; v++)
+    {
+        double x = v / 127.0;
+        amplitude[v] = (type == kPower) ? pow(x, shape) : pow(10.0, shape * (x - 1.0) / 20.0);
+    }
+}
+
+double VelocityCurve::Amplitude(int velocity) const
+{
+    if (velocity <= 0)                       return 0.0;
+    if (velocity >= PitchTables::kNumPitches) velocity = PitchTables::kNumPitches-1;
+    return amplitude[velocity];
+}
+
+VelocityCurve& VelocityCurve::Default(void)
+{
+    static VelocityCurve curve;
+    return curve;
+}
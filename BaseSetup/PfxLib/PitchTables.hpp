@@ -0,0 +1,49 @@
+//
+//  PitchTables.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  MIDI pitch <-> frequency conversion without libm.  The equal-tempered
+//  frequencies of all 128 MIDI notes, the ratio of every cent in a
+//  semitone, and the boundaries halfway (geometrically) between adjacent
+//  notes are built by the compiler, so a conversion is a table read, an
+//  interpolation between cents, or a binary search of 128 entries.
+//
+//  VelocityCurve maps MIDI velocity to amplitude through a 128-entry
+//  table, rebuilt only when the curve is reconfigured.
+//
+
+#pragma once
+
+class PitchTables
+{
+public:
+    static constexpr int    kNumPitches = 128;
+    static constexpr double kA4         = 440.0;    // Hz at MIDI 69
+
+    static double  CentsToRatio(double cents);      // 2^(cents/1200), any sign or size
+    static int     FrequencyToMidi(double freq);    // nearest MIDI pitch, clamped to 0..127
+    static double  FrequencyToPitch(double freq);   // fractional MIDI pitch (binary search + one cent interpolation)
+    static double  MidiToFrequency(int pitch);      // table read; pitch clamped to 0..127
+    static double  MidiToFrequency(double pitch);   // fractional pitch, to within about 1e-14 of pow
+};
+
+class VelocityCurve
+{
+public:
+    enum curveType { kPower, kDecibel };
+
+private:
+    double         amplitude[PitchTables::kNumPitches];
+    curveType      type;
+    double         shape;                           // exponent for kPower, dB span for kDecibel
+
+public:
+                   VelocityCurve(curveType t = kPower, double s = 2.0);
+
+    double         Amplitude(int velocity) const;   // velocity clamped to 0..127; 0 always gives 0
+    void           Set(curveType t, double s);      // rebuild the table; not for the audio thread
+    curveType      Type(void)  const { return type;  }
+    double         Shape(void) const { return shape; }
+
+    static VelocityCurve& Default(void);            // the curve Units use unless given their own
+};
@@ -0,0 +1,87 @@
+//
+//  RealtimeThreads.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "RealtimeThreads.hpp"
+#include <atomic>
+
+#if defined(__APPLE__)
+    #include <mach/mach.h>
+    #include <mach/mach_time.h>
+    #include <mach/thread_policy.h>
+    #include <os/workgroup.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+using namespace std;
+
+static atomic<void*>  audioWorkgroup(nullptr);
+static atomic<double> blockPeriod(512.0 / 44100.0);
+
+void SetAudioWorkgroup(void* workgroup)
+{
+    audioWorkgroup.store(workgroup);
+}
+
+void SetRealtimePeriod(double seconds)
+{
+    if (seconds > 0.0)
+        blockPeriod.store(seconds);
+}
+
+#if defined(__APPLE__)
+
+/* a workgroup has to be left by the thread that joined it, so leave as the thread exits */
+struct WorkgroupMembership
+{
+    os_workgroup_t            group = nullptr;
+    os_workgroup_join_token_s token;
+
+    ~WorkgroupMembership(void)
+    {
+        if (group != nullptr)
+            if (__builtin_available(macOS 11.0, *))
+                os_workgroup_leave(group, &token);
+    }
+};
+
+static thread_local WorkgroupMembership membership;
+
+void PromoteToRealtime(void)
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+
+    double ticks = blockPeriod.load() * 1e9 * timebase.denom / timebase.numer;
+    thread_time_constraint_policy_data_t policy;
+    policy.period      = static_cast<uint32_t>(ticks);
+    policy.computation = static_cast<uint32_t>(ticks * 0.5);
+    policy.constraint  = static_cast<uint32_t>(ticks);
+    policy.preemptible = true;
+    thread_policy_set(mach_thread_self(), THREAD_TIME_CONSTRAINT_POLICY,
+                      reinterpret_cast<thread_policy_t>(&policy), THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+
+    os_workgroup_t group = static_cast<os_workgroup_t>(audioWorkgroup.load());
+    if ((group != nullptr) && (membership.group == nullptr))
+        if (__builtin_available(macOS 11.0, *))
+            if (os_workgroup_join(group, &membership.token) == 0)
+                membership.group = group;
+}
+
+#elif defined(__linux__)
+
+void PromoteToRealtime(void)
+{
+    sched_param param = {};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 10;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+#else
+
+void PromoteToRealtime(void) {}
+
+#endif
@@ -0,0 +1,18 @@
+//
+//  RealtimeThreads.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Scheduling for threads that do audio work off the device's own thread,
+//  such as WorkerPool helpers.  The render thread waits on them inside the
+//  callback, so they need the same treatment it gets: on macOS they join
+//  the output unit's audio workgroup (macOS 11 and later) and take a
+//  time-constraint policy sized to the block period; elsewhere they ask
+//  for SCHED_FIFO, which quietly stays at the normal policy when the
+//  process lacks the privilege.
+//
+
+#pragma once
+
+void SetAudioWorkgroup(void* workgroup);        // the host's os_workgroup_t, or nullptr; not retained, so keep its unit alive
+void SetRealtimePeriod(double seconds);         // time between render callbacks, for the time-constraint policy
+void PromoteToRealtime(void);                   // apply the above to the calling thread (e.g. as a WorkerPool thread init)
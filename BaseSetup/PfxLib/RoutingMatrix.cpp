@@ -0,0 +1,71 @@
+//
+//  RoutingMatrix.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "RoutingMatrix.hpp"
+#include "MixKernels.hpp"
+
+/*
+ Routes are edited from the control thread and read by Apply on the audio
+ thread.  Changing the gain of an existing route is a relaxed store that
+ Apply ramps to over its next block; inserting one needs audio stopped.
+*/
+bool RoutingMatrix::SetGain(Unit* u, int unitChan, int busChan, double gain)
+{
+    size_t i, insertAt = routes.size();
+
+    if (unitChan < 0 || busChan < 0)
+        return false;
+
+    for (i=0; i<routes.size(); i++)
+    {
+        if (routes[i].unit != u) continue;
+        if ((routes[i].unitChan == unitChan) && (routes[i].busChan == busChan))
+        {
+            routes[i].gain.store(gain, memory_order_relaxed);
+            return true;
+        }
+        insertAt = i+1;                         // keep this Unit's routes together
+    }
+
+    routes.insert(routes.begin() + insertAt, Route(u, unitChan, busChan, gain));
+    return true;
+}
+
+void RoutingMatrix::Remove(Unit* u)
+{
+    for (size_t i=routes.size(); i>0; i--)
+        if (routes[i-1].unit == u)
+            routes.erase(routes.begin() + (i-1));
+}
+
+void RoutingMatrix::Apply(PfxSample** bus, unsigned numChans, unsigned count)
+{
+    size_t i = 0, n = routes.size();
+
+    while (i < n)
+    {
+        Unit*  u = routes[i].unit;
+        double v0, v1;
+        bool   on = u->Active() && !u->IsSilent();
+
+        u->AdvanceVolume(count, v0, v1);
+        for (; i<n && routes[i].unit==u; i++)
+        {
+            Route& r    = routes[i];
+            double gain = r.gain.load(memory_order_relaxed);
+            if (on && (r.busChan < static_cast<int>(numChans)) && (r.unitChan < static_cast<int>(u->GetNumChans())))
+            {
+                double g0 = r.current * v0;
+                double g1 = gain      * v1;
+                KernelAccumulate(bus[r.busChan], u->OutputSamples(r.unitChan), g0, (g1-g0)/count, count);
+            }
+            r.current = gain;
+        }
+    }
+
+    if (n > 0)
+        for (unsigned c=0; c<numChans; c++)
+            KernelClip(bus[c], count);
+}
@@ -0,0 +1,49 @@
+//
+//  RoutingMatrix.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  A sparse gain matrix from Unit output channels to bus (device) channels.
+//  Only the connections that exist are stored, each one is applied with a
+//  vectorized multiply-add, and a gain change is ramped across one block.
+//  SetGain on a route that already exists only stores its atomic gain, so
+//  it is safe while audio runs; adding, removing or clearing routes
+//  changes the vector Apply walks and must wait until audio is stopped.
+//
+
+#pragma once
+
+#include "Unit.hpp"
+#include <atomic>
+#include <vector>
+using namespace std;
+
+struct Route
+{
+    Unit*          unit;
+    int            unitChan;    // channel of the Unit's output
+    int            busChan;     // destination bus channel
+    atomic<double> gain;        // target gain; written by SetGain, read by Apply
+    double         current;     // gain reached at the end of the last block
+
+    Route(Unit* u, int uc, int bc, double g) : unit(u), unitChan(uc), busChan(bc), gain(g), current(g) {}
+    Route(const Route& r) : unit(r.unit), unitChan(r.unitChan), busChan(r.busChan), gain(r.gain.load()), current(r.current) {}
+    Route& operator=(const Route& r)
+    {
+        unit = r.unit; unitChan = r.unitChan; busChan = r.busChan;
+        gain.store(r.gain.load()); current = r.current;
+        return *this;
+    }
+};
+
+class RoutingMatrix
+{
+private:
+    vector<Route> routes;   // kept grouped by Unit so each Unit's volume is stepped once per block
+
+public:
+    void     Apply(PfxSample** bus, unsigned numChans, unsigned count);    // add every route into 'bus' and clip the result
+    void     Clear(void)           { routes.clear(); }
+    int      NumRoutes(void) const { return static_cast<int>(routes.size()); }
+    void     Remove(Unit* u);                                               // drop every route from 'u'
+    bool     SetGain(Unit* u, int unitChan, int busChan, double gain);      // add the route, or change its gain; false for a negative channel
+};
@@ -0,0 +1,19 @@
+//
+//  SampleType.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  PfxSample is the type of every Unit buffer, wavetable, envelope table
+//  and mix bus.  The graph runs in single precision by default, which
+//  halves the memory traffic of double and doubles the lanes per vector.
+//  Define PFX_DOUBLE_SAMPLES to build the whole graph in double.  Units
+//  that need extra precision for recursive state, such as phase or long
+//  feedback paths, keep that state in double internally either way.
+//
+
+#pragma once
+
+#ifdef PFX_DOUBLE_SAMPLES
+typedef double PfxSample;
+#else
+typedef float  PfxSample;
+#endif
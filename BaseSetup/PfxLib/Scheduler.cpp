@@ -19,12 +19,15 @@ Task::Task(void)
 }
 
 /* Scheduler constructor */
-Scheduler::Scheduler(int maxTasks)
+Scheduler::Scheduler(int maxTasks) : Scheduler(AudioContext::Default(), maxTasks) {}
+
+Scheduler::Scheduler(AudioContext& ctx, int maxTasks) : Unit(ctx)
 {
     MM              = 120.0;
     sampleCount     = 0L;
     samplesPerMsec  = samplingRate / 1000.0;
     useBeats        = false;
+    active          = true;                 // RunBlock skips inactive Units; the clock must always run
 
 	taskTableSize   = maxTasks;
 	taskTable	    = new Task[maxTasks];
@@ -32,11 +35,15 @@ Scheduler::Scheduler(int maxTasks)
 	waitQueueTails  = new Task*[kWaitQueueSize];
 	lastWaitingTime = 0L;
 	ClearQueues();
+	if (context->GetScheduler() == nullptr)
+		context->SetScheduler(this);
 }
 
 /* Scheduler deconstructor */
 Scheduler::~Scheduler(void)
 {
+	if (context->GetScheduler() == this)
+		context->SetScheduler(nullptr);
 	delete [] waitQueueTails;
 	delete [] waitQueueHeads;
 	delete [] taskTable;
@@ -301,7 +308,27 @@ void Scheduler::Tick(long now)
 		ExecuteTask(task);
 }
 
-void Scheduler::Sample(int sNo)
+/*
+ The Scheduler runs ahead of every other Unit in the block, so all of the
+ block's ticks happen before anything renders.  Each task can still land
+ on its own sample: while it runs, BlockOffset() says how far into the
+ block its time is, for callbacks such as Hit and CNote to pass on to
+ Envelopes::Trigger.  The offset is per thread, so calls made from a
+ control thread see 0 and act at the start of the next block.
+*/
+static thread_local long tickOffset = 0;
+
+long Scheduler::BlockOffset(void)
+{
+    return tickOffset;
+}
+
+void Scheduler::Process(int first, int count)
 {
-    Tick(sampleCount++);
+    for (int j=0; j<count; j++)
+    {
+        tickOffset = first + j;
+        Tick(sampleCount++);
+    }
+    tickOffset = 0;
 }
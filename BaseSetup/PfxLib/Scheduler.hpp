@@ -52,8 +52,10 @@ private:
 
 public:
 				Scheduler(int maxTasks = 16384);
+				Scheduler(AudioContext& ctx, int maxTasks = 16384);     // becomes ctx's Scheduler if it has none yet
 				~Scheduler(void);
 	void		AbortTask(Task* task);
+    static long BlockOffset(void);          // inside a task: the sample of the current block it fell on; 0 elsewhere
     unsigned long CurrentTime(void) { return sampleCount; }
     double      CurrentTimeMS(void) { return sampleCount / samplesPerMsec; }
     Task*       ScheduleTask       (long time, int per, void (*fun)(void* empty));
@@ -63,7 +65,8 @@ public:
     Task*		ScheduleTaskSamples(long time, int per, void (*fun)(void* args), void* args);
     void        SetMM(double newMM);
 	void		Tick(long now);
-    void        Sample(int sNo);
+    void        Process(int first, int count) override;
+    bool        RunsAlways(void) const override { return true; }
 
 private:
 	void		ClearQueues(void);
@@ -7,10 +7,56 @@
  */
 
 #include "Score.hpp"
+#include "WorkerPool.hpp"
+#include "Denormals.hpp"
+#include "RealtimeThreads.hpp"
 
-Score::Score(void) : ugIndex(0), currentState(0) {}
+Score::Score(void) : Score(AudioContext::Default()) {}
 
-Score::~Score(void) {}
+Score::Score(AudioContext& ctx) : currentState(0), ugIndex(0), context(&ctx), flushDenormals(false), numMixChans(2), numOutputs(0), planSize(0), serialPrefix(0), planValid(false), planVersion(0), numRoots(0), pool(nullptr) {}
+
+Score::~Score(void)
+{
+    delete pool;
+}
+
+/* pool helpers run inside the render callback's deadline, so they get its scheduling */
+static void HelperInit(void)         { PromoteToRealtime(); }
+static void HelperInitFlushing(void) { PromoteToRealtime(); FlushDenormals(); }
+
+/*
+ Call while audio is stopped; creating or joining threads is not real-time
+ safe.  Helpers pick up the audio workgroup as they start, so a host that
+ learns its workgroup later (Pfx::SetScore) calls this again.
+*/
+void Score::SetNumThreads(int n)
+{
+    delete pool;
+    pool = nullptr;
+    if (n > 1)
+    {
+        SetRealtimePeriod(context->BufferSize() / context->SamplingRate());
+        pool = new WorkerPool(n, flushDenormals ? HelperInitFlushing : HelperInit);
+    }
+}
+
+int Score::NumThreads(void) const
+{
+    return (pool != nullptr) ? pool->NumWorkers() : 1;
+}
+
+/*
+ The audio thread sets FTZ/DAZ around each ProcessUGs and restores the host's
+ mode afterwards; pool helpers belong to the Score, so they set it once as
+ they start.  Like SetNumThreads, call this while audio is stopped.
+*/
+void Score::SetDenormalProtection(bool onOff)
+{
+    if (onOff == flushDenormals) return;
+    flushDenormals = onOff;
+    if (pool != nullptr)
+        SetNumThreads(pool->NumWorkers());
+}
 
 void Score::AddUG(Unit* ug)
 {
@@ -18,6 +64,188 @@ void Score::AddUG(Unit* ug)
         return;
     
     ugs[ugIndex++] = ug;
+    planValid = false;
+}
+
+void Score::AddOutputUG(Unit* ug)
+{
+    if ((numOutputs >= kMaxUgs) || (ug == nullptr))
+        return;
+    for (int i=0; i<numOutputs; i++)
+        if (outputs[i] == ug) return;
+
+    outputs[numOutputs++] = ug;
+    planValid = false;
+}
+
+void Score::AddRoute(Unit* ug, int unitChan, int mixChan, double gain)
+{
+    if (routing.SetGain(ug, unitChan, mixChan, gain))
+        AddOutputUG(ug);
+}
+
+void Score::MixRoutes(PfxSample** mixChannels)
+{
+    routing.Apply(mixChannels, numMixChans, context->BufferSize());
+}
+
+/*
+ Collect the Units 'u' reads from: whatever it reports as inputs, plus any
+ registered ug that names 'u' as its effect (the effect processes that ug's
+ output, so it has to run after it).
+*/
+int Score::Dependencies(Unit* u, Unit** deps)
+{
+    int n = u->Inputs(deps, kMaxInputs);
+    for (int i=0; i<ugIndex && n<kMaxInputs*2; i++)
+        if (ugs[i]->Effect() == u)
+            deps[n++] = ugs[i];
+    return n;
+}
+
+/*
+ Depth-first, post-order: a Unit enters the plan only after everything it
+ reads from.  A link back to a Unit still on the current path is a feedback
+ loop; that edge is dropped, so the reader sees the previous block.
+*/
+void Score::Visit(Unit* u, Unit** onPath, int depth)
+{
+    int i;
+
+    for (i=0; i<planSize; i++)
+        if (plan[i] == u) return;               // already scheduled
+    for (i=0; i<depth; i++)
+        if (onPath[i] == u) return;             // feedback edge
+    if ((depth >= kMaxPlan) || (planSize >= kMaxPlan))
+        return;
+
+    Unit* deps[kMaxInputs*2];
+    int   n = Dependencies(u, deps);
+
+    onPath[depth] = u;
+    for (i=0; i<n; i++)
+        Visit(deps[i], onPath, depth+1);
+    if (planSize < kMaxPlan)
+        plan[planSize++] = u;
+}
+
+/*
+ Units that no output depends on never enter the plan, so unreachable
+ branches cost nothing.  With no outputs marked, every ug counts as audible.
+ Ugs that run always (the Scheduler) go in first whatever is marked, so
+ their events are in place before anything they drive renders.
+*/
+void Score::BuildPlan(void)
+{
+    Unit* onPath[kMaxPlan];
+
+    planSize = 0;
+    for (int i=0; i<ugIndex; i++)
+        if (ugs[i]->RunsAlways())
+            Visit(ugs[i], onPath, 0);
+    serialPrefix = planSize;
+    if (numOutputs > 0)
+        for (int i=0; i<numOutputs; i++)
+            Visit(outputs[i], onPath, 0);
+    else
+        for (int i=0; i<ugIndex; i++)
+            Visit(ugs[i], onPath, 0);
+
+    BuildEdges();
+    planVersion = context->GraphVersion();
+    planValid   = true;
+}
+
+int Score::PlanIndex(Unit* u) const
+{
+    for (int i=0; i<planSize; i++)
+        if (plan[i] == u) return i;
+    return -1;
+}
+
+/*
+ Turn the plan into a graph of ordering constraints between plan entries.
+ A dependency on an earlier entry means "run after it".  A dependency on a
+ later entry is a dropped feedback edge; it becomes "run before it", so the
+ writer cannot overwrite the buffer while the reader still uses last block's
+ samples.  Every edge then points forward in the plan, so the graph has no
+ cycles.  The serial prefix has finished before the pool starts, so edges
+ touching it are already satisfied and its entries are never roots: the
+ Scheduler's callbacks change Instruments, and must not run beside them.
+*/
+void Score::BuildEdges(void)
+{
+    int   from[kMaxEdges], to[kMaxEdges];
+    int   i, k, numEdges = 0;
+    Unit* deps[kMaxInputs*2];
+
+    for (i=0; i<planSize; i++)
+    {
+        int n = Dependencies(plan[i], deps);
+        for (k=0; k<n && numEdges<kMaxEdges; k++)
+        {
+            int j = PlanIndex(deps[k]);
+            if ((j < 0) || (j == i) || (i < serialPrefix) || (j < serialPrefix)) continue;
+            from[numEdges] = (j < i) ? j : i;
+            to  [numEdges] = (j < i) ? i : j;
+            numEdges++;
+        }
+    }
+
+    for (i=0; i<=planSize; i++) succStart[i] = 0;
+    for (i=0; i<planSize;  i++) depCount [i] = 0;
+    for (k=0; k<numEdges; k++)
+    {
+        succStart[from[k]+1]++;
+        depCount [to[k]]++;
+    }
+    for (i=0; i<planSize; i++)
+        succStart[i+1] += succStart[i];
+
+    int fill[kMaxPlan];
+    for (i=0; i<planSize; i++) fill[i] = succStart[i];
+    for (k=0; k<numEdges; k++)
+        succList[fill[from[k]]++] = to[k];
+
+    numRoots = 0;
+    for (i=serialPrefix; i<planSize; i++)
+        if (depCount[i] == 0)
+            roots[numRoots++] = i;
+}
+
+void Score::ProcessJob(void* score, int job, int worker)
+{
+    Score* s = static_cast<Score*>(score);
+    Unit*  u = s->plan[job];
+
+    u->RunBlock(0, s->context->BufferSize());
+    for (int k=s->succStart[job]; k<s->succStart[job+1]; k++)
+    {
+        int next = s->succList[k];
+        if (s->pending[next].fetch_sub(1, memory_order_acq_rel) == 1)
+            s->pool->Push(worker, next);
+    }
+}
+
+void Score::ProcessUGs(void)
+{
+    DenormalGuard guard(flushDenormals);
+
+    if (!planValid || (planVersion != context->GraphVersion()))
+        BuildPlan();
+
+    if ((pool == nullptr) || (planSize - serialPrefix < kMinParallelPlan))
+    {
+        for (int i=0; i<planSize; i++)
+            plan[i]->RunBlock(0, context->BufferSize());
+        return;
+    }
+
+    for (int i=0; i<serialPrefix; i++)
+        plan[i]->RunBlock(0, context->BufferSize());
+    for (int i=serialPrefix; i<planSize; i++)
+        pending[i].store(depCount[i], memory_order_relaxed);
+    pool->Run(ProcessJob, this, roots, numRoots, planSize - serialPrefix);
 }
 
 void Score::AllUGsOn(void)
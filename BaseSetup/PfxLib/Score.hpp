@@ -10,22 +10,71 @@
 #define __Score__
 
 #include "Unit.hpp"
+#include "RoutingMatrix.hpp"
+#include <atomic>
+using namespace std;
 
 class Score
 {
 public:
-    static const int kMaxUgs = 100;
+    static const int kMaxUgs    = 100;
+    static const int kMaxPlan   = kMaxUgs * 2;  // ugs plus Units only reachable through links
+    static const int kMaxInputs = 8;            // most inputs one Unit may report
+    static const int kMaxEdges  = kMaxPlan * kMaxInputs * 2;
+    static const int kMinParallelPlan = 4;      // smaller plans are not worth waking the pool for
     int          currentState;
     int          ugIndex;
     Unit*        ugs[kMaxUgs];
 
+protected:
+    AudioContext* context;                      // rate, block size and graph version of every Unit in this Score
+    bool         flushDenormals;                // run with FTZ/DAZ set on the audio and worker threads
+    unsigned     numMixChans;                   // channels in the mixChannels RouteAudio is given
+    RoutingMatrix routing;                      // Unit channel -> mix channel gains applied by MixRoutes
+    int          numOutputs;                    // Units RouteAudio mixes into mixChannels
+    Unit*        outputs[kMaxUgs];
+    int          planSize;                      // execution plan: every Unit an output depends on,
+    Unit*        plan[kMaxPlan];                // each after all of its inputs
+    int          serialPrefix;                  // leading plan entries (run-always Units and their inputs) run before any parallel work
+    bool         planValid;
+    unsigned     planVersion;                   // context->GraphVersion() the plan was built from
+
+    /* plan as a dependency graph, for running independent branches in parallel */
+    int          numRoots;                      // plan entries with no dependencies
+    int          roots[kMaxPlan];
+    int          depCount[kMaxPlan];            // how many plan entries must finish before each one
+    int          succStart[kMaxPlan+1];         // successors of entry i are succList[succStart[i] .. succStart[i+1])
+    int          succList[kMaxEdges];
+    atomic<int>  pending[kMaxPlan];             // depCount counted down during a block
+    class WorkerPool* pool;
+
 public:
                  Score(void);
+                 Score(AudioContext& ctx);
     virtual     ~Score(void);
+    void         AddOutputUG(Unit* ug);         // mark 'ug' as audible; with none marked every ug is
+    void         AddRoute(Unit* ug, int unitChan, int mixChan, double gain = 1.0);   // route one channel of 'ug' to a mix channel (marks it audible)
     void         AddUG(Unit* ug);
     void         AllUGsOn(void);
+    void         BuildPlan(void);
+    AudioContext& Context(void)     const { return *context;     }
     int          CurrentState(void) const { return currentState; }
-	virtual void RouteAudio(double** mixChannels) = 0;
+    unsigned     MixChans(void)     const { return numMixChans;  }
+    int          NumThreads(void)   const;      // threads the plan runs on, including the audio thread
+    void         MixRoutes(PfxSample** mixChannels);    // add every routed Unit channel into mixChannels
+    int          PlanSize(void)     const { return planSize;     }
+    void         ProcessUGs(void);              // run the plan over one block, rebuilding it if the graph changed
+    void         SetDenormalProtection(bool onOff);  // flush denormals to zero while the plan runs
+    void         SetMixChans(unsigned n)  { numMixChans = n;     }
+    void         SetNumThreads(int n);          // run the plan on 'n' threads (including the audio thread); 1 is serial
+	virtual void RouteAudio(PfxSample** mixChannels) = 0;
+
+private:
+    void         BuildEdges(void);
+    int          Dependencies(Unit* u, Unit** deps);
+    int          PlanIndex(Unit* u) const;
+    static void  ProcessJob(void* score, int job, int worker);
+    void         Visit(Unit* u, Unit** onPath, int depth);
 };
 
 #endif //__Score__
@@ -0,0 +1,184 @@
+//
+//  Simd.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  SimdVec<T> wraps the vector registers of whatever instruction set the
+//  target is compiled for (AVX, SSE2 or NEON) behind one small interface,
+//  so a block kernel is written once and runs kWidth lanes at a time.
+//  Defining PFX_NO_SIMD, or building for a target with none of these,
+//  selects the one-lane scalar version.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if   !defined(PFX_NO_SIMD) && defined(__AVX__)
+    #include <immintrin.h>
+    #define PFX_SIMD_AVX  1
+#elif !defined(PFX_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define PFX_SIMD_SSE2 1
+#elif !defined(PFX_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define PFX_SIMD_NEON 1
+#endif
+
+template <typename T>
+struct SimdScalar
+{
+    typedef T V;
+    enum { kWidth = 1 };
+
+    static V    Load (const T* p)     { return *p;              }
+    static void Store(T* p, V v)      { *p = v;                 }
+    static V    Set  (T x)            { return x;               }
+    static V    Zero (void)           { return T(0);            }
+    static V    Add  (V a, V b)       { return a + b;           }
+    static V    Sub  (V a, V b)       { return a - b;           }
+    static V    Mul  (V a, V b)       { return a * b;           }
+    static V    Min  (V a, V b)       { return (b < a) ? b : a; }
+    static V    Max  (V a, V b)       { return (b > a) ? b : a; }
+    static V    Abs  (V a)            { return (a < T(0)) ? -a : a; }
+
+    /* comparisons return an all-ones / all-zeros bit mask, as the vector versions do */
+    typedef typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type U;
+    static V    Less (V a, V b)       { U m = (a < b) ? ~U(0) : U(0); V r; memcpy(&r, &m, sizeof(r)); return r; }
+    static V    And  (V a, V b)       { U x, y; memcpy(&x, &a, sizeof(x)); memcpy(&y, &b, sizeof(y)); x &= y; memcpy(&a, &x, sizeof(a)); return a; }
+};
+
+template <typename T> struct SimdVec : SimdScalar<T> {};
+
+#if defined(PFX_SIMD_AVX)
+
+template <> struct SimdVec<double>
+{
+    typedef __m256d V;
+    enum { kWidth = 4 };
+
+    static V    Load (const double* p) { return _mm256_loadu_pd(p);    }
+    static void Store(double* p, V v)  { _mm256_storeu_pd(p, v);       }
+    static V    Set  (double x)        { return _mm256_set1_pd(x);     }
+    static V    Zero (void)            { return _mm256_setzero_pd();   }
+    static V    Add  (V a, V b)        { return _mm256_add_pd(a, b);   }
+    static V    Sub  (V a, V b)        { return _mm256_sub_pd(a, b);   }
+    static V    Mul  (V a, V b)        { return _mm256_mul_pd(a, b);   }
+    static V    Min  (V a, V b)        { return _mm256_min_pd(a, b);   }
+    static V    Max  (V a, V b)        { return _mm256_max_pd(a, b);   }
+    static V    Abs  (V a)             { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static V    Less (V a, V b)        { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static V    And  (V a, V b)        { return _mm256_and_pd(a, b);   }
+};
+
+template <> struct SimdVec<float>
+{
+    typedef __m256 V;
+    enum { kWidth = 8 };
+
+    static V    Load (const float* p)  { return _mm256_loadu_ps(p);    }
+    static void Store(float* p, V v)   { _mm256_storeu_ps(p, v);       }
+    static V    Set  (float x)         { return _mm256_set1_ps(x);     }
+    static V    Zero (void)            { return _mm256_setzero_ps();   }
+    static V    Add  (V a, V b)        { return _mm256_add_ps(a, b);   }
+    static V    Sub  (V a, V b)        { return _mm256_sub_ps(a, b);   }
+    static V    Mul  (V a, V b)        { return _mm256_mul_ps(a, b);   }
+    static V    Min  (V a, V b)        { return _mm256_min_ps(a, b);   }
+    static V    Max  (V a, V b)        { return _mm256_max_ps(a, b);   }
+    static V    Abs  (V a)             { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static V    Less (V a, V b)        { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static V    And  (V a, V b)        { return _mm256_and_ps(a, b);   }
+};
+
+#elif defined(PFX_SIMD_SSE2)
+
+template <> struct SimdVec<double>
+{
+    typedef __m128d V;
+    enum { kWidth = 2 };
+
+    static V    Load (const double* p) { return _mm_loadu_pd(p);       }
+    static void Store(double* p, V v)  { _mm_storeu_pd(p, v);          }
+    static V    Set  (double x)        { return _mm_set1_pd(x);        }
+    static V    Zero (void)            { return _mm_setzero_pd();      }
+    static V    Add  (V a, V b)        { return _mm_add_pd(a, b);      }
+    static V    Sub  (V a, V b)        { return _mm_sub_pd(a, b);      }
+    static V    Mul  (V a, V b)        { return _mm_mul_pd(a, b);      }
+    static V    Min  (V a, V b)        { return _mm_min_pd(a, b);      }
+    static V    Max  (V a, V b)        { return _mm_max_pd(a, b);      }
+    static V    Abs  (V a)             { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static V    Less (V a, V b)        { return _mm_cmplt_pd(a, b);    }
+    static V    And  (V a, V b)        { return _mm_and_pd(a, b);      }
+};
+
+template <> struct SimdVec<float>
+{
+    typedef __m128 V;
+    enum { kWidth = 4 };
+
+    static V    Load (const float* p)  { return _mm_loadu_ps(p);       }
+    static void Store(float* p, V v)   { _mm_storeu_ps(p, v);          }
+    static V    Set  (float x)         { return _mm_set1_ps(x);        }
+    static V    Zero (void)            { return _mm_setzero_ps();      }
+    static V    Add  (V a, V b)        { return _mm_add_ps(a, b);      }
+    static V    Sub  (V a, V b)        { return _mm_sub_ps(a, b);      }
+    static V    Mul  (V a, V b)        { return _mm_mul_ps(a, b);      }
+    static V    Min  (V a, V b)        { return _mm_min_ps(a, b);      }
+    static V    Max  (V a, V b)        { return _mm_max_ps(a, b);      }
+    static V    Abs  (V a)             { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static V    Less (V a, V b)        { return _mm_cmplt_ps(a, b);    }
+    static V    And  (V a, V b)        { return _mm_and_ps(a, b);      }
+};
+
+#elif defined(PFX_SIMD_NEON)
+
+template <> struct SimdVec<double>
+{
+    typedef float64x2_t V;
+    enum { kWidth = 2 };
+
+    static V    Load (const double* p) { return vld1q_f64(p);          }
+    static void Store(double* p, V v)  { vst1q_f64(p, v);              }
+    static V    Set  (double x)        { return vdupq_n_f64(x);        }
+    static V    Zero (void)            { return vdupq_n_f64(0.0);      }
+    static V    Add  (V a, V b)        { return vaddq_f64(a, b);       }
+    static V    Sub  (V a, V b)        { return vsubq_f64(a, b);       }
+    static V    Mul  (V a, V b)        { return vmulq_f64(a, b);       }
+    static V    Min  (V a, V b)        { return vminq_f64(a, b);       }
+    static V    Max  (V a, V b)        { return vmaxq_f64(a, b);       }
+    static V    Abs  (V a)             { return vabsq_f64(a);          }
+    static V    Less (V a, V b)        { return vreinterpretq_f64_u64(vcltq_f64(a, b)); }
+    static V    And  (V a, V b)        { return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(a), vreinterpretq_u64_f64(b))); }
+};
+
+template <> struct SimdVec<float>
+{
+    typedef float32x4_t V;
+    enum { kWidth = 4 };
+
+    static V    Load (const float* p)  { return vld1q_f32(p);          }
+    static void Store(float* p, V v)   { vst1q_f32(p, v);              }
+    static V    Set  (float x)         { return vdupq_n_f32(x);        }
+    static V    Zero (void)            { return vdupq_n_f32(0.0f);     }
+    static V    Add  (V a, V b)        { return vaddq_f32(a, b);       }
+    static V    Sub  (V a, V b)        { return vsubq_f32(a, b);       }
+    static V    Mul  (V a, V b)        { return vmulq_f32(a, b);       }
+    static V    Min  (V a, V b)        { return vminq_f32(a, b);       }
+    static V    Max  (V a, V b)        { return vmaxq_f32(a, b);       }
+    static V    Abs  (V a)             { return vabsq_f32(a);          }
+    static V    Less (V a, V b)        { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+    static V    And  (V a, V b)        { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+};
+
+#endif
+
+/* Ramp: lanes hold start, start+step, start+2*step, ... */
+template <typename T>
+inline typename SimdVec<T>::V SimdRamp(T start, T step)
+{
+    T lanes[SimdVec<T>::kWidth];
+    for (int i=0; i<SimdVec<T>::kWidth; i++)
+        lanes[i] = start + step * i;
+    return SimdVec<T>::Load(lanes);
+}
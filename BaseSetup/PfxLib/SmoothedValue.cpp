@@ -0,0 +1,151 @@
+//
+//  SmoothedValue.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "SmoothedValue.hpp"
+#include <math.h>
+
+const double SmoothedValue::kSnap = 1.0e-6;
+
+static const double kOnePoleReach = 0.999;     // a one-pole ramp covers this much of the distance in its ramp time
+
+SmoothedValue::SmoothedValue(double initial, smoothMode m) : target(initial), jumpFrom(NAN), rampLength(0), serial(0), mode(m), defaultRamp(0), seen(0), shape(m), current(initial), goal(initial), step(0.0), remaining(0) {}
+
+void SmoothedValue::Reset(double value)
+{
+    seen      = serial.load(memory_order_acquire);
+    target.store(value, memory_order_relaxed);
+    current   = value;
+    goal      = value;
+    remaining = 0;
+}
+
+void SmoothedValue::SetTarget(double value)
+{
+    SetTarget(NAN, value, defaultRamp.load(memory_order_relaxed));
+}
+
+void SmoothedValue::SetTarget(double value, long samples)
+{
+    SetTarget(NAN, value, samples);
+}
+
+void SmoothedValue::SetTarget(double from, double value, long samples)
+{
+    jumpFrom  .store(from,    memory_order_relaxed);
+    rampLength.store(samples, memory_order_relaxed);
+    target    .store(value,   memory_order_relaxed);
+    serial.fetch_add(1, memory_order_release);
+}
+
+/*
+ A write that lands while we read the fields is picked up again on the
+ next call, since its serial bump comes after them.  A SetMode made
+ before a SetTarget is published by that SetTarget's serial bump.
+*/
+void SmoothedValue::Poll(void)
+{
+    unsigned now = serial.load(memory_order_acquire);
+    if (now == seen) return;
+    seen = now;
+
+    double from = jumpFrom.load(memory_order_relaxed);
+    long   n    = rampLength.load(memory_order_relaxed);
+    goal        = target.load(memory_order_relaxed);
+    if (!isnan(from))
+        current = from;
+
+    if ((n <= 0) || (current == goal))
+    {
+        current   = goal;
+        remaining = 0;
+        return;
+    }
+
+    shape = mode.load(memory_order_relaxed);
+    switch (shape)
+    {
+        case kExponential:
+            if ((current * goal) > 0.0)
+            {
+                step      = pow(goal / current, 1.0 / n);
+                remaining = n;
+                break;
+            }
+            shape = kLinear;                    // a zero or a sign change has no constant ratio
+            [[fallthrough]];
+        case kLinear:
+            step      = (goal - current) / n;
+            remaining = n;
+            break;
+        case kOnePole:
+            step      = pow(1.0 - kOnePoleReach, 1.0 / n);
+            remaining = 1;                      // runs until it snaps
+            break;
+    }
+}
+
+unsigned SmoothedValue::Segment(unsigned count, double& start, double& inc)
+{
+    Poll();
+    start = current;
+    inc   = 0.0;
+    if (remaining <= 0) return count;
+
+    unsigned n;
+    double   end;
+
+    if (shape == kOnePole)
+    {
+        n   = (count < kPiece) ? count : kPiece;
+        end = goal - (goal - current) * pow(step, n);
+        if (fabs(goal - end) <= kSnap * (fabs(goal) > 1.0 ? fabs(goal) : 1.0))
+        {
+            end       = goal;
+            remaining = 0;
+        }
+    }
+    else
+    {
+        n = (remaining < count) ? static_cast<unsigned>(remaining) : count;
+        if (shape == kLinear)
+            end = current + step * n;
+        else
+        {
+            if (n > kPiece) n = kPiece;
+            end = current * pow(step, n);
+        }
+        remaining -= n;
+        if (remaining == 0)
+            end = goal;                         // land exactly, whatever the rounding
+    }
+
+    inc     = (end - current) / n;
+    current = end;
+    return n;
+}
+
+double SmoothedValue::Advance(unsigned count)
+{
+    double start, inc;
+    for (unsigned done=0; done<count; )
+        done += Segment(count - done, start, inc);
+    return current;
+}
+
+bool SmoothedValue::Render(PfxSample* dst, unsigned count)
+{
+    Poll();
+    if (remaining <= 0) return false;
+
+    for (unsigned done=0; done<count; )
+    {
+        double   start, inc;
+        unsigned n = Segment(count - done, start, inc);
+        for (unsigned i=0; i<n; i++)
+            dst[done+i] = static_cast<PfxSample>(start + inc * i);
+        done += n;
+    }
+    return true;
+}
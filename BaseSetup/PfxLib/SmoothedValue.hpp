@@ -0,0 +1,72 @@
+//
+//  SmoothedValue.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  A parameter that glides to new values instead of jumping.  The control
+//  thread calls SetTarget, which only stores atomics; the audio thread
+//  picks the change up at its next Segment or Render and draws the ramp.
+//  Ramps are handed out as linear segments (start value, per-sample step,
+//  length), so a consumer applies one with a single vector kernel call
+//  and a parameter that is not moving costs one test per block.
+//
+//  kLinear       straight line to the target over the ramp time
+//  kExponential  constant ratio per sample (equal steps in dB); falls back
+//                to linear when either end is zero or the signs differ
+//  kOnePole      first-order lag: each sample covers a fixed fraction of
+//                the remaining distance; snaps once within kSnap of target
+//
+//  Curved modes are drawn as linear pieces of at most kPiece samples.
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+#include <atomic>
+using namespace std;
+
+class SmoothedValue
+{
+public:
+    enum smoothMode { kLinear, kExponential, kOnePole };
+    static const unsigned kPiece = 32;          // longest linear piece of a curved ramp
+    static const double   kSnap;                // one-pole distance treated as arrival
+
+private:
+    atomic<double>   target;                    // written by SetTarget
+    atomic<double>   jumpFrom;                  // value to restart from, or NaN to glide from wherever we are
+    atomic<long>     rampLength;                // samples for the next ramp; 0 jumps
+    atomic<unsigned> serial;                    // bumped by SetTarget once the fields above are stored
+    atomic<smoothMode> mode;                    // SetMode; read when the next SetTarget is taken up
+    atomic<long>     defaultRamp;               // ramp length SetTarget(value) uses
+    unsigned         seen;                      // serial the audio thread last acted on
+
+    smoothMode       shape;                     // how the ramp in progress is drawn (kExponential may fall back to kLinear)
+    double           current;                   // value at the start of the next sample
+    double           goal;                      // target of the ramp in progress
+    double           step;                      // linear: increment; exponential: ratio; one-pole: remaining fraction per sample
+    long             remaining;                 // samples left in a linear or exponential ramp
+
+public:
+                     SmoothedValue(double initial = 0.0, smoothMode m = kLinear);
+
+    double           Current(void) const { return current; }                 // value reached so far (audio thread)
+    bool             Moving(void)  const { return (remaining > 0) || (serial.load(memory_order_acquire) != seen); }
+    void             Reset(double value);                                     // jump now, dropping any ramp (audio thread, or while stopped)
+    double           Target(void)  const { return target.load(memory_order_relaxed); }
+
+    /* control side: lock-free, safe from any single writer thread */
+    void             SetMode(smoothMode m)  { mode.store(m, memory_order_relaxed); }
+    void             SetRamp(long samples)  { defaultRamp.store((samples > 0) ? samples : 0, memory_order_relaxed); }   // length SetTarget(value) ramps over
+    void             SetTarget(double value);                                 // glide to 'value' over the default ramp
+    void             SetTarget(double value, long samples);                   // glide to 'value' over 'samples'
+    void             SetTarget(double from, double value, long samples);      // restart at 'from', then glide to 'value'
+
+    /* audio side */
+    double           Advance(unsigned count);                                 // skip 'count' samples; returns the value reached
+    bool             Render(PfxSample* dst, unsigned count);                  // write 'count' per-sample values; false (dst untouched) if constant
+    double           Value(void)            { Poll(); return current; }      // Current(), after taking up any pending SetTarget
+    unsigned         Segment(unsigned count, double& start, double& inc);     // next linear piece of at most 'count' samples; returns its length
+
+private:
+    void             Poll(void);                                              // start the ramp the control side asked for, if any
+};
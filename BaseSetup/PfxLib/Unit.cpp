@@ -7,130 +7,116 @@
  */
 
 #include "Unit.hpp"
+#include "BufferArena.hpp"
+#include "MixKernels.hpp"
+#include "PitchTables.hpp"
 #include <cstddef>
+#include <cstring>
 #include <math.h>
 
-const int    Unit::kMaxChans    = 2;
-unsigned int Unit::bufferSize   = 0;
-double       Unit::samplingRate = 0.0;
+const double Unit::kSilence     = 1.0e-7;
 
-Unit::Unit(void) : channel(0), numChans(2), volumeTask(nullptr), active(false), bypass(false), inputUnit(nullptr), volume(1.0)
-{
-	Init();
-}
+Unit::Unit(void) : Unit(AudioContext::Default(), kStereo) {}
 
-Unit::Unit(int chans) : channel(0), volumeTask(nullptr), active(false), bypass(false), inputUnit(nullptr), volume(1.0)
+Unit::Unit(int chans) : Unit(AudioContext::Default(), chans) {}
+
+Unit::Unit(AudioContext& ctx, int chans) : channel(0), volumeTask(nullptr), context(&ctx), active(false), asleep(false), bypass(false), inputUnit(nullptr), volume(1.0)
 {
 	numChans = chans;
+	if (numChans < 1)         numChans = 1;
+	if (numChans > kMaxChans) numChans = kMaxChans;
 	Init();
 }
 
 void Unit::Init(void)
 {
-    unsigned i, j;
-
-    if (samplingRate == 0.0)
-		samplingRate = 44100.0;
-	if (bufferSize	 == 0)
-		bufferSize = 512;
+    unsigned i;
 
-	outputSamples = new double*[numChans];
-	for (i=0; i<numChans; i++)
+	bufferSize    = context->BufferSize();
+	samplingRate  = context->SamplingRate();
+	bufferArena   = context->Arena();
+	allocChans    = numChans;
+	outputSamples = new PfxSample*[allocChans];
+	for (i=0; i<allocChans; i++)
 	{
-		outputSamples[i] = new double[bufferSize];
+		outputSamples[i] = bufferArena->Allocate();
 		feedback     [i] = 0.0;
-        for (j=0; j<bufferSize; j++)
-            outputSamples[i][j] = 0.0;
 	}
+	outputView    = outputSamples;
+	history       = nullptr;
+	historyChans  = 0;
+	historyMask   = 0;
+	historyNext   = 0;
+	historyStart  = 0;
 
 	analysisValue = 0.0;
-	desiredVol	  = 1.0;
 	effect		  = nullptr;
 	inputChannel  = 0;
-	unitInc       = 0.0;
+	sanitize      = false;
+	silent        = false;
+	velocityCurve = &VelocityCurve::Default();
 	controlRate   = samplingRate / bufferSize;
 	msPerSample   = 1000.0 / samplingRate;
 }
 
 Unit::~Unit(void)
 {
-	for (unsigned i=0; i<numChans; i++)
-		delete [] outputSamples[i];
+	FreeHistory();
+	for (unsigned i=0; i<allocChans; i++)
+		bufferArena->Release(outputSamples[i]);
 	delete [] outputSamples;
 }
 
 void Unit::Bypass(int sNo)
+{
+    Bypass(sNo, 1);
+}
+
+/*
+ A bypassed Unit normally copies nothing: it points outputView at the
+ upstream buffers (or at the arena's shared silence when it has no input),
+ so OutputSamples() and GetSample() read them directly.  Only a down-mix,
+ which has to compute new samples, writes into the Unit's own buffer.
+ Since the whole buffer is aliased, any range within the block works.
+*/
+void Unit::Bypass(int first, int count)
 {
     unsigned i;
-    
+    int      j, last = first + count;
+
     if (inputUnit == nullptr)
     {
         for (i=0; i<numChans; i++)
-            outputSamples[i][sNo] = 0.0;
-        return;
-    }
-    
-    double** in      = inputUnit->OutputSamples();
-    unsigned inChans = inputUnit->GetNumChans();
-    
-    if (inChans == numChans)
-    {
-        for (i=0; i<numChans; i++)
-            outputSamples[i][sNo] = in[i][sNo];
-        return;
-    }
-    
-    if ((inChans==1) && (numChans==2))
-    {
-        for (i=0; i<numChans; i++)
-            outputSamples[i][sNo] = in[0][sNo];
+            aliasSamples[i] = bufferArena->Silence();
+        outputView = aliasSamples;
         return;
     }
-    
-    if ((inChans==2) && (numChans==1))
+
+    PfxSample** in      = inputUnit->OutputSamples();
+    unsigned    inChans = inputUnit->GetNumChans();
+
+    if ((numChans == 1) && (inChans > 1))       // down-mix: average every input channel
     {
-        outputSamples[0][sNo] = (in[0][sNo] + in[1][sNo]) * 0.5;
+        double share = 1.0 / inChans;
+        for (j=first; j<last; j++)
+        {
+            double sum = 0.0;
+            for (i=0; i<inChans; i++)
+                sum += in[i][j];
+            outputSamples[0][j] = sum * share;
+        }
+        outputView = outputSamples;
         return;
     }
+
+    for (i=0; i<numChans; i++)                  // same layout, up-mix or re-map: wrap around the input channels
+        aliasSamples[i] = in[i % inChans];
+    outputView = aliasSamples;
 }
 
 void Unit::Bypass(void)
 {
-	unsigned i, j;
-    
-    if (inputUnit == nullptr)
-    {
-        for (i=0; i<numChans; i++)
-            for (j=0; j<bufferSize; j++)
-                outputSamples[i][j] = 0.0;
-        return;
-    }
-    
-	double** in      = inputUnit->OutputSamples();
-	unsigned inChans = inputUnit->GetNumChans();
-	
-	if (inChans == numChans)
-    {
-		for (i=0; i<numChans; i++)
-			for (j=0; j<bufferSize; j++)
-				outputSamples[i][j] = in[i][j];
-		return;
-	}
-	
-	if ((inChans==1) && (numChans==2))
-    {
-		for (i=0; i<numChans; i++)
-			for (j=0; j<bufferSize; j++)
-				outputSamples[i][j] = in[0][j];
-		return;
-	}
-		
-	if ((inChans==2) && (numChans==1))
-    {
-		for (i=0; i<bufferSize; i++)
-			outputSamples[0][i] = (in[0][i] + in[1][i]) * 0.5;
-		return;
-	}
+    Bypass(0, bufferSize);
 }
 
 double Unit::CheckRange(double sample)
@@ -146,6 +132,7 @@ void Unit::Clear(void)
 	for (unsigned i=0; i<numChans; i++)
 		for (unsigned j=0; j<bufferSize; j++)
 			outputSamples[i][j] = 0.0;
+	outputView = outputSamples;
 }
 
 double Unit::Clip(double sample)
@@ -155,147 +142,141 @@ double Unit::Clip(double sample)
 	return sample; 
 }
 
-double Unit::GetSample(int s)
+/*
+ Without a history ring only the newest block is available, and 's' wraps
+ around it as before.  With one, 's' counts from sample 0 of the newest
+ block into the ring, so -1 is the last sample of the block before it.
+*/
+int Unit::Wrap(int s) const
 {
-    while (s <  0)          s += bufferSize;
-    while (s >= bufferSize) s -= bufferSize;
-    return outputSamples[0][s];
+    s %= static_cast<int>(bufferSize);
+    return (s < 0) ? s + bufferSize : s;
 }
 
-double Unit::GetSampleXVolume(int s)
+PfxSample Unit::GetSample(int s)
 {
-    while (s <  0)          s += bufferSize;
-    while (s >= bufferSize) s -= bufferSize;
-    return (outputSamples[0][s] * volume);
+    return GetSample(0, s);
 }
 
-double Unit::GetSample(int c, int s)
+PfxSample Unit::GetSampleXVolume(int s)
 {
-    while (s <  0)          s += bufferSize;
-    while (s >= bufferSize) s -= bufferSize;
-    return outputSamples[c][s];
+    return GetSample(0, s) * volume.Value();
 }
 
-void Unit::GetOutputSamples(double* buffer)
+PfxSample Unit::GetSample(int c, int s)
 {
-	if (!active) return;
-
-	int i;
-	switch (numChans) {
-		case 1: for (i=0; i<bufferSize; i++)
-                {
-                    ScaleVolume();
-                    buffer[i] = Clip(outputSamples[0][i] * volume);
-                }
-                break;
-		
-		case 2:	for (i=0; i<bufferSize; i++)
-                {
-                    ScaleVolume();
-                    buffer[i] = Clip((outputSamples[0][i]+outputSamples[1][i]) * 0.5 * volume);
-                }
-                break;
-	}
+    if (history != nullptr)
+        return history[c][(historyStart + s) & historyMask];
+    return outputView[c][Wrap(s)];
 }
 
-void Unit::GetOutputSamples(double** buffer, unsigned channels)
+void Unit::GetOutputSamples(PfxSample* buffer)
 {
-	if (!active) return;
-
-	unsigned i, j;
+	WriteOutputSamples(&buffer, 1, false);
+}
 
-	if (channels == numChans) {
-		for (j=0; j<bufferSize; j++)
-        {
-			ScaleVolume();
-			for (i=0; i<channels; i++)
-				buffer[i][j] = Clip(outputSamples[i][j] * volume);
-		}
-		return;
-	}
-	
-	if ((channels==1) && (numChans==2)) {
-		for (i=0; i<bufferSize; i++)
-        {
-			ScaleVolume();
-			buffer[0][i] = Clip((outputSamples[0][i]+outputSamples[1][i]) * 0.5 * volume);
-		}
-		return;
-	}
-	
-	if ((channels==2) && (numChans==1)) {
-		for (j=0; j<bufferSize; j++)
-        {
-			ScaleVolume();
-			for (i=0; i<2; i++)
-				buffer[i][j] = Clip(outputSamples[0][j] * volume);
-		}
-		return;
-	}
+void Unit::GetOutputSamples(PfxSample** buffer, unsigned channels)
+{
+	WriteOutputSamples(buffer, channels, false);
 }
 
-void Unit::MixOutputSamples(double* buffer)
+void Unit::MixOutputSamples(PfxSample* buffer)
 {
-	if (!active) return;
+	WriteOutputSamples(&buffer, 1, true);
+}
 
-	int i;
-	switch (numChans) {
-		case 1: for (i=0; i<bufferSize; i++)
-                {
-                    ScaleVolume();
-                    buffer[i] = Clip(buffer[i] + (outputSamples[0][i] * volume));
-                }
-                break;
-		
-		case 2:	for (i=0; i<bufferSize; i++)
-                {
-                    ScaleVolume();
-                    buffer[i] = Clip(buffer[i] + (((outputSamples[0][i]+outputSamples[1][i])*0.5) * volume));
-                }
-                break;
-	}
+void Unit::MixOutputSamples(PfxSample** buffer, unsigned channels)
+{
+	WriteOutputSamples(buffer, channels, true);
 }
 
-void Unit::MixOutputSamples(double** buffer, unsigned channels)
+/*
+ Copy or add the Unit's buffer(s) into 'buffer', scaled by volume and clipped.
+ The block is split into the linear pieces the volume SmoothedValue hands
+ out, so each kernel call sees one gain segment (a single piece when the
+ volume is steady) instead of stepping the volume sample by sample.
+ Matching layouts copy channel for channel, a mono Unit feeds every channel,
+ a mono destination gets the average of all channels, and any other pair
+ folds Unit channel i onto destination channel i % channels.
+*/
+void Unit::WriteOutputSamples(PfxSample** buffer, unsigned channels, bool mix)
 {
 	if (!active) return;
 
-    unsigned i, j;
-
-	if (channels == numChans) {
-		for (j=0; j<bufferSize; j++)
-        {
-			ScaleVolume();
+	PfxSample** out = outputView;
+	unsigned    i, done = 0;
+	if (silent)                             // nothing to add; keep the volume ramp moving
+	{
+		double v0, v1;
+		AdvanceVolume(bufferSize, v0, v1);
+		if (!mix)
 			for (i=0; i<channels; i++)
-				buffer[i][j] = Clip(buffer[i][j] + (outputSamples[i][j] * volume));
-		}
+				KernelZero(buffer[i], bufferSize);
 		return;
 	}
-	
-	if ((channels==1) && (numChans==2)) {
-		for (i=0; i<bufferSize; i++)
-        {
-			ScaleVolume();
-			buffer[0][i] = Clip(buffer[0][i] + (((outputSamples[0][i]+outputSamples[1][i])*0.5) * volume));
+	while (done < bufferSize)
+	{
+		double   gain, inc;
+		unsigned n = volume.Segment(bufferSize - done, gain, inc);
+
+		if (channels == numChans)
+		{
+			for (i=0; i<channels; i++)
+				if (mix) KernelMix (buffer[i]+done, out[i]+done, gain, inc, n);
+				else     KernelCopy(buffer[i]+done, out[i]+done, gain, inc, n);
 		}
-		return;
-	}
-	
-	if ((channels==2) && (numChans==1)) {
-		for (j=0; j<bufferSize; j++)
-        {
-			ScaleVolume();
-			for (i=0; i<2; i++)
-				buffer[i][j] = Clip(buffer[i][j] + (outputSamples[0][j] * volume));
+		else if ((channels==1) && (numChans==2))
+		{
+			if (mix) KernelMixDown (buffer[0]+done, out[0]+done, out[1]+done, gain, inc, n);
+			else     KernelCopyDown(buffer[0]+done, out[0]+done, out[1]+done, gain, inc, n);
 		}
-		return;
+		else if ((channels==2) && (numChans==1))
+		{
+			if (mix) KernelMixUp (buffer[0]+done, buffer[1]+done, out[0]+done, gain, inc, n);
+			else     KernelCopyUp(buffer[0]+done, buffer[1]+done, out[0]+done, gain, inc, n);
+		}
+		else if (numChans == 1)
+		{
+			for (i=0; i<channels; i++)
+				if (mix) KernelMix (buffer[i]+done, out[0]+done, gain, inc, n);
+				else     KernelCopy(buffer[i]+done, out[0]+done, gain, inc, n);
+		}
+		else
+		{
+			unsigned folds = (numChans + channels - 1) / channels;      // Unit channels landing on one destination
+			double   share = (numChans > channels) ? 1.0 / folds : 1.0;
+			if (!mix)
+				for (i=0; i<channels; i++)
+					KernelZero(buffer[i]+done, n);
+			for (i=0; i<numChans || i<channels; i++)
+				KernelAccumulate(buffer[i % channels]+done, out[i % numChans]+done, gain*share, inc*share, n);
+			for (i=0; i<channels; i++)
+				KernelClip(buffer[i]+done, n);
+		}
+		done += n;
 	}
 }
 
+/*
+ For consumers that apply the Unit's volume themselves (such as a routing
+ matrix feeding several bus channels): run the ramp across one block and
+ report the volume at its start and end, so the caller can draw one linear
+ ramp between them.
+*/
+void Unit::AdvanceVolume(unsigned count, double& startVol, double& endVol)
+{
+	double   inc;
+	unsigned done = volume.Segment(count, startVol, inc);
+
+	if (done < count)
+		volume.Advance(count - done);
+	endVol = volume.Current();
+}
+
 int Unit::FrequencyToMidi(double freq)
 {
     if ((freq>=0.0) && (freq<=5000.0))
-        return round(12.0*log2(freq/440.0) + 69.0);
+        return PitchTables::FrequencyToMidi(freq);
     else
         return -1;
 }
@@ -303,32 +284,64 @@ int Unit::FrequencyToMidi(double freq)
 double Unit::MidiToFrequency(int midiPitch)
 {
 	if ((midiPitch>=0) && (midiPitch<=119))
-		return 440.0 * pow(2.0, (double)(midiPitch-69)/12.0);
+		return PitchTables::MidiToFrequency(midiPitch);
+	else
+		return -1.0;
+}
+
+double Unit::MidiToFrequency(double midiPitch)
+{
+	if ((midiPitch>=0.0) && (midiPitch<=119.0))
+		return PitchTables::MidiToFrequency(midiPitch);
 	else
 		return -1.0;
 }
 
 double Unit::VelocityToAmplitude(int velocity)
 {
-    const double exponent = 2.0; // You can adjust this exponent
-    return pow(velocity / 127.0, exponent);
+    return velocityCurve->Amplitude(velocity);
 }
 
+void Unit::SetVelocityCurve(const VelocityCurve* c)
+{
+    velocityCurve = (c != nullptr) ? c : &VelocityCurve::Default();
+}
+
+/* a recirculating signal is where NaNs and denormals build up, so feedback turns sanitizing on */
 void Unit::SetFeedback(double f, int chan)
 {
-	if ((chan<0) || (chan>=2)) return;
+	if ((chan<0) || (chan>=kMaxChans)) return;
 	feedback[chan] = f;
+	if (f != 0.0) sanitize = true;
 }
 
 void Unit::SetFeedback(double f)
 {
-	feedback[0] = f;
+	SetFeedback(f, 0);
+}
+
+void Unit::SetBypass(bool onOff)
+{
+	bypass = onOff;
+	Wake();
+	if (!bypass)
+		outputView = outputSamples;
+}
+
+int Unit::Inputs(class Unit** in, int max) const
+{
+	if ((inputUnit == nullptr) || (max < 1)) return 0;
+	in[0] = inputUnit;
+	return 1;
 }
 
 void Unit::SetInputUnit(class Unit* in)
 {
 	inputUnit    = in;
 	bypass		 = false;
+	outputView   = outputSamples;
+	context->GraphChanged();
+	Wake();
 }
 
 void Unit::SetInputUnit(class Unit* in, int chan)
@@ -336,73 +349,178 @@ void Unit::SetInputUnit(class Unit* in, int chan)
 	inputUnit    = in;
 	inputChannel = chan;
 	bypass		 = false;
+	outputView   = outputSamples;
+	context->GraphChanged();
+	Wake();
 }
 
 void Unit::TurnOn(class Unit* in)
 {
-	active    = true;
-	inputUnit = in;
-	bypass    = false;
+	active     = true;
+	inputUnit  = in;
+	bypass     = false;
+	outputView = outputSamples;
+	context->GraphChanged();
+	Wake();
 }
 
 void Unit::TurnOn(double vol)
 {
 	active = true;
-	volume = vol;
+	volume.SetTarget(vol, 0);
+	Wake();
+}
+
+void Unit::Process(int first, int count)
+{
+    if (!active) return;
+    if (bypass) { Bypass(first, count); return; }
+    for (unsigned i=0; i<numChans; i++)
+        KernelZero(outputSamples[i]+first, count);
+}
+
+/*
+ Runs after Process on every block, so anything that has to see the
+ finished buffer lives here rather than in each subclass.  Only the
+ Unit's own buffers are touched: a bypassed Unit's view belongs upstream.
+*/
+void Unit::PostProcess(int first, int count)
+{
+    unsigned i;
+    double   peak = 0.0;
+
+    if (sanitize && (outputView == outputSamples))
+        for (i=0; i<numChans; i++)
+            KernelSanitize(outputSamples[i]+first, count);
+
+    for (i=0; i<numChans && peak<kSilence; i++)
+        peak = KernelPeak<PfxSample>(outputView[i]+first, count);
+    silent.store((peak < kSilence) && (silent.load(memory_order_relaxed) || first == 0), memory_order_relaxed);
+
+    WriteHistory(first, count);
+}
+
+/*
+ A Unit sleeps once its last block was silent, it says it would stay that
+ way (Idle), and everything it reads is silent too.  Going to sleep zeroes
+ its buffers once, so readers see exact silence rather than the quiet tail
+ of the last block; after that a sleeping Unit costs a few flag tests.
+ TurnOn, SetVolume, NoteOut and rewiring all wake it.
+*/
+void Unit::RunBlock(int first, int count)
+{
+    if (!active) return;
+    if (silent && Idle() && InputsSilent())
+    {
+        if (!asleep.load(memory_order_relaxed))
+        {
+            Clear();
+            asleep.store(true, memory_order_relaxed);
+        }
+        WriteHistory(first, count);
+        return;
+    }
+
+    asleep.store(false, memory_order_relaxed);
+    Process    (first, count);
+    PostProcess(first, count);
 }
 
-void Unit::ScaleVolume(void)
+bool Unit::InputsSilent(void) const
 {
-	if (unitInc == 0.0) return;
+    Unit* in[8];
+    int   n = Inputs(in, 8);
 
-	volume     += unitInc;
-	double diff = desiredVol - volume;
-	if (diff < 0.0) diff = -diff;
-	if (diff < 0.05)
+    for (int i=0; i<n; i++)
+        if (!in[i]->IsSilent()) return false;
+    return true;
+}
+
+void Unit::WriteHistory(int first, int count)
+{
+    unsigned i;
+
+    if (history == nullptr) return;
+    if (first == 0)
     {
-		volume  = desiredVol;
-		unitInc = 0.0;
-	}
+        historyStart = historyNext;
+        historyNext += bufferSize;
+    }
+
+    unsigned at    = (historyStart + first) & historyMask;
+    unsigned split = historyMask + 1 - at;                  // room before the ring wraps
+    if (split > static_cast<unsigned>(count)) split = count;
+    for (i=0; i<numChans && i<historyChans; i++)
+    {
+        memcpy(history[i] + at, outputView[i] + first,         split         * sizeof(PfxSample));
+        memcpy(history[i],      outputView[i] + first + split, (count-split) * sizeof(PfxSample));
+    }
+}
+
+/*
+ The ring holds the newest block plus at least 'ms' before it, rounded up
+ to a power of two so a read is one add and one mask.  It is filled by
+ PostProcess, so only Units the Score runs keep one.  Allocates; call it
+ while audio is stopped.
+*/
+void Unit::SetHistory(double ms)
+{
+    FreeHistory();
+    if (ms <= 0.0) return;
+
+    unsigned need   = static_cast<unsigned>(ceil(ms / msPerSample)) + bufferSize;
+    unsigned length = 1;
+    while (length < need) length <<= 1;
+
+    historyChans = numChans;
+    history      = new PfxSample*[historyChans];
+    for (unsigned i=0; i<historyChans; i++)
+        history[i] = new PfxSample[length]();
+    historyMask  = length - 1;
+    historyNext  = 0;
+    historyStart = 0;
+}
+
+void Unit::FreeHistory(void)
+{
+    for (unsigned i=0; i<historyChans; i++)
+        delete [] history[i];
+    delete [] history;
+    history      = nullptr;
+    historyChans = 0;
+    historyMask  = 0;
 }
 
 void Unit::Sample(int sNo)
 {
-    if (!active) return;
-    if (bypass) { Bypass(sNo); return; }
-    for (unsigned i=0; i<numChans; i++)
-        outputSamples[i][sNo] = 0.0;
+    Process(sNo, 1);
 }
 
 void Unit::Update(void)
 {
-    for (int i=0; i<bufferSize; i++)
-        Sample(i);
+    Process(0, bufferSize);
+}
+
+long Unit::MsToSamples(double ms) const
+{
+	double n = ms / msPerSample;
+	return (n < 1.0) ? 0 : static_cast<long>(n + 0.5);
 }
 
 void Unit::DownFromHere(long duration, double to)
 {
-	double rampSamples = static_cast<double>(duration) / msPerSample;
-	if (rampSamples <= 0.0)
-	{
-		SetVolume(to);
-		return;				// avoid division by zero
-	}
-	double from  = GetVolume();
-	double range = to - from;
-	desiredVol   = to;
-	unitInc      = range/rampSamples;
+	volume.SetTarget(to, MsToSamples(duration));
+	Wake();
 }
 
 void Unit::VolumeLine(double from, long duration, double to)
 {
-	SetVolume(from);
-    double rampSamples = static_cast<double>(duration) / msPerSample;
-	if (rampSamples <= 0.0)
-	{
-		SetVolume(to);
-		return;				// avoid division by zero
-	}
-	double range = to - from;
-	desiredVol   = to;
-	unitInc      = range/rampSamples;
+	volume.SetTarget(from, to, MsToSamples(duration));
+	Wake();
+}
+
+void Unit::SetVolumeGlide(double ms, SmoothedValue::smoothMode m)
+{
+	volume.SetMode(m);
+	volume.SetRamp(MsToSamples(ms));
 }
@@ -8,46 +8,67 @@
 
 #pragma  once
 
+#include "SampleType.hpp"
+#include "AudioContext.hpp"
+#include "SmoothedValue.hpp"
+#include <atomic>
 #include <vector>
 using namespace std;
 
 class Unit
 {
 public:
-    enum channelType { kMono = 1, kStereo };    // A Unit can either be mono or stereo
-    static unsigned int bufferSize;             // Size of buffer
-    static const int    kMaxChans;              // Maximum number of channels
+    enum channelType { kMono = 1, kStereo };    // Common channel counts; any count up to kMaxChans is allowed
+    unsigned int        bufferSize;             // Size of buffer (the context's block size when the Unit was built)
+    static constexpr int kMaxChans = 32;        // Maximum number of channels
+    static const double kSilence;               // peak below which a block counts as silent (about -140 dB)
     unsigned int        channel;                // Which channel
     unsigned int        numChans;               // Unit's number of channels
 	class Task*         volumeTask;             // Pointer to a volume task
 
 protected:
-	static double	 samplingRate;              // Sampling Rate
+	AudioContext*    context;                   // engine this Unit belongs to
+	double           samplingRate;              // Sampling Rate (the context's, when the Unit was built)
 	
-	bool             active;                    // Is this unit on?
+	/* active, asleep and silent are written by control threads (TurnOn, Wake) while the audio thread reads them */
+	atomic<bool>     active;                    // Is this unit on?
+	atomic<bool>     asleep;                    // skipped by RunBlock; its buffers hold exact zeros
+	unsigned         allocChans;                // number of buffers taken from bufferArena
 	double           analysisValue;
+	class BufferArena* bufferArena;             // arena this Unit's buffers came from
 	bool             bypass;                    // Should this unit be bypassed?
 	double           controlRate;               // Buffer fills and empties per second
-	double           desiredVol;                // the target volume
 	class Unit*      effect;
-	double           feedback[2];               // feedback value for each channel
+	double           feedback[kMaxChans];       // feedback value for each channel
+	PfxSample**      history;                   // optional ring of past output per channel (see SetHistory), or nullptr
+	unsigned         historyChans;              // channels in history
+	unsigned         historyMask;               // ring length - 1; the length is a power of two
+	unsigned         historyNext;               // ring position the next block starts at
+	unsigned         historyStart;              // ring position of sample 0 of the newest block
 	int              inputChannel;              // which channel input should feed
 	class Unit*      inputUnit;                 // Unit that provides input
 	double           msPerSample;               // ms per sample
-	double**         outputSamples;             // pointer to Unit's buffer(s)
-	double           unitInc;                   // An amount to increment every sample (used for various things)
-	double           volume;                    // current Unit volume
+	atomic<bool>     silent;                    // the newest block peaked below kSilence
+	bool             sanitize;                  // zero NaN/denormal samples after each Process (see PostProcess)
+	PfxSample**      outputSamples;             // pointer to Unit's buffer(s)
+	PfxSample**      outputView;                // what readers see: outputSamples, or aliasSamples while bypassed
+	PfxSample*       aliasSamples[kMaxChans];   // upstream buffers a bypassed Unit passes through without copying
+	const class VelocityCurve* velocityCurve;   // velocity -> amplitude table used by VelocityToAmplitude
+	SmoothedValue    volume;                    // Unit volume; ramps are drawn per block by WriteOutputSamples
 
 public:
                    Unit();                      // Default Constructor - numChans initialized to stereo.  See Init() for more.
                    Unit(int chans);             // Should we make this 'explicit'? See Init() for more.
+                   Unit(AudioContext& ctx, int chans = kStereo);    // build the Unit in 'ctx' rather than AudioContext::Default()
     virtual       ~Unit();                      // Destructor - clean up allocated buffers
 	
 	bool		   Active()			const  { return active;			}       // active accessor
+	void           AdvanceVolume(unsigned count, double& startVol, double& endVol); // step the volume ramp over 'count' samples once, reporting where it started and ended
 	double		   AnalysisValue()	const  { return analysisValue;  }       // analysisValue accessor
 	unsigned int   BufferSize()		const  { return bufferSize;		}       // bufferSize accessor
     void           Bypass(int sNo);
-    void           SetBypass(bool onOff)   { bypass = onOff;        }       // set bypass to true or false
+    void           Bypass(int first, int count);                            // Send input directly to output for samples [first, first+count)
+    void           SetBypass(bool onOff);                                   // set bypass to true or false
 
 	double		   CheckRange(double sample);                               // bash NANs and underflow/overflow hazards to zero (from Miller Puckette)
 	void		   Clear();                                                 // Set all buffer values to zero
@@ -56,54 +77,76 @@ public:
 	class Unit*	   Effect() const			{ return effect;		   }	// effect unit accessor
 	unsigned       GetNumChans() const		{ return numChans;         }	// numChans accessor
 	
-	virtual void   GetOutputSamples(double* buffer);						// Place the contents of the Unit's buffer into the buffer passed in.
-	virtual void   GetOutputSamples(double** buffer, unsigned channels);    // Place the contents of the Unit's buffer(s) into the buffer(s) pointed to by 'buffer'
-    double         GetSample(int s);
-    double         GetSampleXVolume(int s);
-    double         GetSample(int c, int s);
-    static double  GetSamplingRateMS(void)  { return samplingRate / 1000.0; }
-    static double  GetSamplingRate(void)    { return samplingRate;     }
-	double		   GetVolume(void) const	{ return volume;		   }	// volume accessor
+	virtual void   GetOutputSamples(PfxSample* buffer);					// Place the contents of the Unit's buffer into the buffer passed in.
+	virtual void   GetOutputSamples(PfxSample** buffer, unsigned channels); // Place the contents of the Unit's buffer(s) into the buffer(s) pointed to by 'buffer'
+    PfxSample      GetSample(int s);                                        // sample 's' of the newest block; negative 's' reaches back into the history ring
+    PfxSample      GetSampleXVolume(int s);
+    PfxSample      GetSample(int c, int s);
+    unsigned       HistoryLength(void) const { return history ? historyMask + 1 : 0; }  // samples GetSample can reach back, including the newest block
+    static class BufferArena* Arena(void)   { return AudioContext::Default().Arena(); }     // the default context's arena
+    AudioContext&  Context(void) const      { return *context;         }    // context accessor
+    static void    CreateArena(unsigned numUnits) { AudioContext::Default().CreateArena(numUnits); }
+    double         GetSamplingRateMS(void) const { return samplingRate / 1000.0; }
+    double         GetSamplingRate(void) const   { return samplingRate;  }
+	double		   GetVolume(void) const	{ return volume.Target();  }	// the volume last set; the audio thread may still be ramping to it
 	int			   InputChannel(void) const { return inputChannel;	   }	// inputChannel accessor
+	virtual int    Inputs(class Unit** in, int max) const;                  // Units read by Process; fills 'in' with up to 'max' of them and returns the count
 	class Unit*	   InputUnit(void)          { return inputUnit;        }	// inputUnit accessor
+	bool           InputsSilent(void) const;                                // every Unit reported by Inputs() is silent
+	virtual bool   Idle(void) const         { return false;            }    // would stay silent, given silent inputs, until woken; sleeping is opt-in
+	virtual bool   RunsAlways(void) const   { return false;            }    // runs every block though no output reads it (e.g. the Scheduler)
+	bool           IsSilent(void) const     { return silent;           }    // silent accessor
     bool           IsOn(void)               { return active;           }    // active accessor
 	
     int            FrequencyToMidi(double freq);                            // convert frequency to corresponding MIDI note number
-    double         VelocityToAmplitude(int velocity);
+    double         VelocityToAmplitude(int velocity);                       // look 'velocity' up in velocityCurve
     double		   MidiToFrequency(int midiPitch);							// convert MIDI note number to corresponding frequency
+    double		   MidiToFrequency(double midiPitch);						// fractional MIDI pitch (e.g. 60.25 is 25 cents above middle C)
+    void           SetVelocityCurve(const class VelocityCurve* c);          // nullptr restores VelocityCurve::Default()
 
-	virtual void   MixOutputSamples(double* buffer);						// Add values in Unit's buffer to values currently in 'buffer'
-	virtual void   MixOutputSamples(double** buffer, unsigned channels);    // Add values in Unit's buffer(s) to values currently in buffer(s) pointed to by 'buffer'
-	double**	   OutputSamples(void)  const { return outputSamples;    }	// Access Unit's buffer's
-	double*		   OutputSamples(int c) const { return outputSamples[c]; }	// Access a specific channel of the Unit's buffers
-    virtual void   Sample(int sNo);
+	virtual void   MixOutputSamples(PfxSample* buffer);					// Add values in Unit's buffer to values currently in 'buffer'
+	virtual void   MixOutputSamples(PfxSample** buffer, unsigned channels); // Add values in Unit's buffer(s) to values currently in buffer(s) pointed to by 'buffer'
+	PfxSample**	   OutputSamples(void)  const { return outputView;       }	// Access Unit's buffer's
+	PfxSample*	   OutputSamples(int c) const { return outputView[c];    }	// Access a specific channel of the Unit's buffers
+    virtual void   Process(int first, int count);                           // Compute samples [first, first+count) of the Unit's buffer(s)
+    void           PostProcess(int first, int count);                       // Per-block bookkeeping the Score runs after Process
+    void           RunBlock(int first, int count);                          // Process + PostProcess, or nothing while asleep; what the Score calls
+    virtual void   Sample(int sNo);                                         // Compute a single sample; compatibility shim for Process(sNo, 1)
     void           SetActive(bool a)             { active     = a;       }  // set active
-	static  void   SetBufferSize(unsigned int b) { bufferSize = b;       }  // bufferSize mutator
+	static  void   SetBufferSize(unsigned int b) { AudioContext::Default().SetBufferSize(b); }  // block size of Units built from now on in the default context
     void           SetChannel(unsigned int c)    { channel    = c;       }  // channel mutator
-	void		   SetEffect(class Unit* e)      { effect     = e;       }  // effect unit mutator
+	void		   SetEffect(class Unit* e)      { effect     = e; context->GraphChanged(); }  // effect unit mutator
 
 	void		   SetFeedback(double f);                                   // set feedback of first channel to 'f'
 	
 	void		   SetFeedback(double f, int chan);							// set feedback of channel 'c' to 'f'
+	void		   SetHistory(double ms);                                   // keep at least 'ms' of past output beyond the current block; 0 removes it
+	void		   SetSanitize(bool onOff)    { sanitize		= onOff; }	// sanitize mutator; SetFeedback turns it on
 	void		   SetInputChannel(int c)     { inputChannel	= c;   }	// inputChannel mutator
 	
 	virtual void   SetInputUnit(class Unit* in);							// set input unit to 'in'
 	virtual void   SetInputUnit(class Unit* in, int chan);					// set the input unit on channel 'chan' to 'in'
 	void		   SetNumChans(int n)         { numChans		= n;   }	// numChans mutator
-	static void	   SetSampleRate(double r)    { samplingRate	= r;   }	// samplingRate mutator
-	void		   SetVolume(double newVol)   { volume		= newVol;  }	// volume mutator
-	virtual void   TurnOn(void)               { active		= true;	   }	// Set active to true
-	virtual void   TurnOn(long)               { active		= true;	   }	// Set active to true
+	static void	   SetSampleRate(double r)    { AudioContext::Default().SetSampleRate(r); }	// rate of Units built from now on in the default context
+	void		   SetVolume(double newVol)   { volume.SetTarget(newVol); Wake(); }	// volume mutator; glides if SetVolumeGlide was given a time
+	void		   SetVolumeGlide(double ms, SmoothedValue::smoothMode m = SmoothedValue::kLinear);   // how SetVolume moves to a new value
+	virtual void   TurnOn(void)               { active		= true; Wake(); }	// Set active to true
+	virtual void   TurnOn(long)               { active		= true; Wake(); }	// Set active to true
 	virtual void   TurnOn(double vol);										// Set active to true and set volume to 'vol'
-	virtual void   TurnOn(double, double)     { active		= true;	   }	// Set active to true
+	virtual void   TurnOn(double, double)     { active		= true; Wake(); }	// Set active to true
 	virtual void   TurnOn(class Unit* in);									// Set input unit to 'in' and set active to true
 	virtual void   TurnOff(void)              { active		= false;   }	// Set active to false
     virtual void   Update(void);											// Sets Unit's buffer vals to 0.  This is typically overridden in derived classes.
 	void		   VolumeLine(double from, long duration, double to);       // Adjust volume from 'from' to 'to' over 'duration' ms.
+	void           Wake(void)               { silent = false; asleep = false; } // make RunBlock process the next block
 
 protected:
 	void           Bypass(void);        // Send input directly to output
 	double         Clip(double sample); // If samples are below -1 or above 1 set them to -1 and 1 respectively
+	void           FreeHistory(void);
 	void           Init(void);          // Called on construction - create output buffer (one or two channels) and set member variables to reasonable defaults
-	virtual void   ScaleVolume(void);
+	long           MsToSamples(double ms) const;    // whole samples in 'ms'; 0 below one sample
+	int            Wrap(int s) const;   // fold 's' into [0, bufferSize)
+	void           WriteHistory(int first, int count);
+	void           WriteOutputSamples(PfxSample** buffer, unsigned channels, bool mix);   // Shared body of Get/MixOutputSamples
 };
@@ -0,0 +1,177 @@
+//
+//  WavetableCache.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "WavetableCache.hpp"
+#include "Fft.hpp"
+#include <array>
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <tuple>
+
+/*
+ The built-in sine: a quarter wave from the Taylor series (exact to
+ double precision on [0, pi/2] well inside 20 terms), unfolded by symmetry
+ so the halves and quarters match bit for bit, plus the guard points.
+*/
+static constexpr double kPi = 3.14159265358979323846264338328;
+
+static constexpr double ConstSin(double x)
+{
+    double term = x, r = x;
+    for (int k=1; k<20; k++)
+    {
+        term *= -x * x / ((2*k) * (2*k + 1));
+        r    += term;
+    }
+    return r;
+}
+
+static constexpr long kSineSize = Wavetable::kDefaultSize;
+static constexpr long kSineSpan = kSineSize + Wavetable::kGuardBefore + Wavetable::kGuardAfter;
+
+static constexpr array<PfxSample, kSineSpan> BuildSine(void)
+{
+    array<PfxSample, kSineSpan> t {};
+    const long quarter = kSineSize / 4;
+    PfxSample* s = &t[Wavetable::kGuardBefore];
+
+    for (long i=0; i<=quarter; i++)
+        s[i] = static_cast<PfxSample>(ConstSin(2.0 * kPi * i / kSineSize));
+    for (long i=quarter+1; i<=2*quarter; i++)
+        s[i] = s[2*quarter - i];
+    for (long i=2*quarter+1; i<kSineSize; i++)
+        s[i] = -s[i - 2*quarter];
+    s[-1] = s[kSineSize - 1];
+    for (long i=0; i<Wavetable::kGuardAfter; i++)
+        s[kSineSize + i] = s[i];
+    return t;
+}
+
+static constexpr array<PfxSample, kSineSpan> builtInSine = BuildSine();
+
+static_assert(builtInSine[Wavetable::kGuardBefore] == 0, "sine starts at zero");
+
+// Sine-phase amplitude of harmonic k in the Fourier series of each shape:
+// the sawtooth falls from +1, the ramp rises from -1, the square starts
+// high and the triangle starts at zero heading up.
+
+static double HarmonicAmplitude(Wavetable::shape type, int k)
+{
+    switch (type)
+    {
+        case Wavetable::kSawtooth: return  2.0 / (M_PI * k);
+        case Wavetable::kRamp:     return -2.0 / (M_PI * k);
+        case Wavetable::kSquare:   return (k & 1) ? 0.95 * 4.0 / (M_PI * k) : 0.0;
+        case Wavetable::kTriangle: return (k & 1) ? ((k & 2) ? -8.0 : 8.0) / (M_PI * M_PI * k * k) : 0.0;
+        default:                   return (k == 1) ? 1.0 : 0.0;
+    }
+}
+
+// Sum harmonics 1..harmonics of a shape with one inverse transform, so
+// every size costs O(n log n); sizes that are not a power of two go
+// through Dft's chirp-z path.
+
+static void Synthesize(PfxSample* dst, long size, Wavetable::shape type, int harmonics)
+{
+    vector<double> re(size, 0.0), im(size, 0.0);
+    for (int k=1; k<=harmonics; k++)
+    {
+        double b = HarmonicAmplitude(type, k);
+        im[k]        = -0.5 * b;                // -i b/2 at +k and +i b/2 at -k sum to b sin(kx)
+        im[size - k] =  0.5 * b;
+    }
+    Dft(re.data(), im.data(), size, true);
+    for (long i=0; i<size; i++)
+        dst[i] = re[i];
+}
+
+int Wavetable::Levels(shape s, long n)
+{
+    if (s == kSine || s == kTest || n < 2)
+        return 1;
+
+    int count = 0;
+    while (count < kMaxLevels && (n >> (count + 1)) > 0)
+        count++;
+    return count;
+}
+
+// Saw, square, ramp and triangle get one band-limited table per octave:
+// level L keeps only the harmonics that stay under Nyquist while the
+// increment is at most 2^L table positions per sample.  Sine has nothing
+// to remove and kTest is a diagnostic pattern (alternating 1 and 0).
+
+Wavetable::Wavetable(shape s, long n, int level) : storage(n + kGuardBefore + kGuardAfter), size(n)
+{
+    PfxSample* dst = storage.data() + kGuardBefore;
+
+    switch (s)
+    {
+        case kSine:
+        {
+            double piSize = 8.0 * atan(1.0) / n;
+            for (long i=0; i<n; i++)
+                dst[i] = sin(piSize*i);
+            break;
+        }
+        case kTest:
+        {
+            for (long i=0; i<n; i++)
+                dst[i] = (i%2)?1.0:0.0;
+            break;
+        }
+        default:
+        {
+            int harmonics = (int)(n >> (level + 1));
+            if (level == 0 && harmonics > 1)
+                harmonics--;                    // the Nyquist bin carries no sine component
+            Synthesize(dst, n, s, harmonics);
+            break;
+        }
+    }
+
+    dst[-1] = dst[n - 1];
+    for (long i=0; i<kGuardAfter; i++)
+        dst[n + i] = dst[i % n];
+    samples = dst;
+}
+
+typedef tuple<int, long, int> tableKey;
+
+static mutex                                      cacheLock;
+static map<tableKey, shared_ptr<const Wavetable>> cache;
+
+shared_ptr<const Wavetable> WavetableCache::Get(Wavetable::shape s, long size, int level)
+{
+    if (size < Wavetable::kMinSize)
+        return nullptr;
+    int levels = Wavetable::Levels(s, size);
+    if (level < 0)       level = 0;
+    if (level >= levels) level = levels - 1;
+
+    lock_guard<mutex> hold(cacheLock);
+    shared_ptr<const Wavetable>& entry = cache[tableKey(s, size, level)];
+    if (!entry)
+    {
+        if (s == Wavetable::kSine && size == kSineSize)
+            entry = shared_ptr<const Wavetable>(new Wavetable(builtInSine.data() + Wavetable::kGuardBefore, kSineSize));
+        else
+            entry = shared_ptr<const Wavetable>(new Wavetable(s, size, level));
+    }
+    return entry;
+}
+
+void WavetableCache::Purge(void)
+{
+    lock_guard<mutex> hold(cacheLock);
+    for (auto i = cache.begin(); i != cache.end(); )
+    {
+        if (i->second.use_count() == 1)
+            i = cache.erase(i);
+        else
+            ++i;
+    }
+}
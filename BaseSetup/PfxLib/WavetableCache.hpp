@@ -0,0 +1,56 @@
+//
+//  WavetableCache.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Process-wide store of read-only oscillator tables, keyed by (shape,
+//  size, band-limit level).  A table is built the first time anyone asks
+//  for it and then shared by every Oscillator that uses it, so creating a
+//  voice costs a map lookup and voices playing the same shape read the
+//  same cache lines.  The default 8192-point sine is built by the compiler
+//  and never touches the heap.
+//
+//  Each Wavetable carries guard points: Samples()[-1] repeats the last
+//  sample and Samples()[size .. size+2] repeat the first three, so an
+//  interpolator reading up to one point behind and two ahead of any index
+//  in [0, size) never has to wrap.
+//
+
+#pragma once
+
+#include "SampleType.hpp"
+#include <memory>
+#include <vector>
+using namespace std;
+
+class Wavetable
+{
+public:
+    enum shape { kSine, kSawtooth, kSquare, kRamp, kTriangle, kTest };
+    static const int  kGuardBefore = 1;
+    static const int  kGuardAfter  = 3;
+    static const int  kMaxLevels   = 16;        // level L holds the harmonics safe below 2^L positions/sample
+    static const long kDefaultSize = 8192;
+    static const long kMinSize     = 2;         // smallest table WavetableCache will build
+
+private:
+    vector<PfxSample> storage;                  // guards included; empty for the built-in sine
+    const PfxSample*  samples;                  // storage + kGuardBefore
+    long              size;
+
+    Wavetable(shape s, long n, int level);
+    Wavetable(const PfxSample* builtIn, long n) : samples(builtIn), size(n) {}
+    friend class WavetableCache;
+
+public:
+    static int        Levels(shape s, long n);  // mipmap levels 's' has at size 'n'; at least 1
+
+    const PfxSample*  Samples(void) const       { return samples; }
+    long              Size(void) const          { return size;    }
+};
+
+class WavetableCache
+{
+public:
+    static shared_ptr<const Wavetable> Get(Wavetable::shape s, long size, int level = 0);    // nullptr below kMinSize
+    static void                        Purge(void);     // drop tables no one holds any more
+};
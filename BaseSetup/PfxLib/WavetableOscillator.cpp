@@ -0,0 +1,274 @@
+//
+//  WavetableOscillator.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "WavetableOscillator.hpp"
+#include "Fft.hpp"
+#include "MixKernels.hpp"
+#include <math.h>
+
+/*
+ Level 0 of each frame is the data as given.  Level L keeps harmonics up
+ to size >> (L+1), found by transforming the frame once and inverting a
+ truncated copy of its spectrum for every level.
+*/
+WavetableFrames::WavetableFrames(const PfxSample* data, int count, long n) : size(n), frames(count)
+{
+    levels = 0;
+    while (levels < Wavetable::kMaxLevels && (n >> (levels + 1)) > 0)
+        levels++;
+    stride = n + Wavetable::kGuardBefore + Wavetable::kGuardAfter;
+    storage.assign(stride * frames * levels, PfxSample(0));
+
+    vector<double> specRe(n), specIm(n), re(n), im(n);
+    for (int f=0; f<frames; f++)
+    {
+        const PfxSample* src = data + f * n;
+        for (long i=0; i<n; i++)
+        {
+            specRe[i] = src[i];
+            specIm[i] = 0.0;
+        }
+        Fft(specRe.data(), specIm.data(), n);
+
+        for (int l=0; l<levels; l++)
+        {
+            PfxSample* dst = storage.data() + (f * levels + l) * stride + Wavetable::kGuardBefore;
+
+            if (l == 0)
+                for (long i=0; i<n; i++)
+                    dst[i] = src[i];
+            else
+            {
+                long keep = n >> (l + 1);
+                for (long k=0; k<n; k++)
+                {
+                    bool inBand = (k <= keep) || (k >= n - keep);
+                    re[k] = inBand ? specRe[k] : 0.0;
+                    im[k] = inBand ? specIm[k] : 0.0;
+                }
+                Fft(re.data(), im.data(), n, true);
+                for (long i=0; i<n; i++)
+                    dst[i] = re[i] / n;
+            }
+
+            dst[-1] = dst[n - 1];
+            for (long i=0; i<Wavetable::kGuardAfter; i++)
+                dst[n + i] = dst[i % n];
+        }
+    }
+}
+
+shared_ptr<const WavetableFrames> WavetableFrames::FromSamples(const PfxSample* data, int count, long n)
+{
+    if (data == nullptr || count < 1 || n < 2 || !IsPowerOfTwo(n))
+        return nullptr;
+    return shared_ptr<const WavetableFrames>(new WavetableFrames(data, count, n));
+}
+
+shared_ptr<const WavetableFrames> WavetableFrames::FromShapes(const vector<Wavetable::shape>& shapes, long n)
+{
+    if (shapes.empty() || n < 2 || !IsPowerOfTwo(n))
+        return nullptr;
+
+    vector<PfxSample> data(shapes.size() * n);
+    for (size_t f=0; f<shapes.size(); f++)
+    {
+        shared_ptr<const Wavetable> t = WavetableCache::Get(shapes[f], n);
+        for (long i=0; i<n; i++)
+            data[f * n + i] = t->Samples()[i];
+    }
+    return FromSamples(data.data(), (int)shapes.size(), n);
+}
+
+const PfxSample* WavetableFrames::Frame(int f, int level) const
+{
+    if (f < 0)            f = 0;
+    if (f >= frames)      f = frames - 1;
+    if (level < 0)        level = 0;
+    if (level >= levels)  level = levels - 1;
+    return storage.data() + (f * levels + level) * stride + Wavetable::kGuardBefore;
+}
+
+// The set a new voice starts with: sine, triangle, square, sawtooth.
+// Built on first use and shared by every WavetableOscillator after that.
+
+static shared_ptr<const WavetableFrames> DefaultFrames(void)
+{
+    static shared_ptr<const WavetableFrames> set =
+        WavetableFrames::FromShapes({ Wavetable::kSine, Wavetable::kTriangle, Wavetable::kSquare, Wavetable::kSawtooth });
+    return set;
+}
+
+WavetableOscillator::WavetableOscillator(void) : WavetableOscillator(AudioContext::Default()) {}
+
+WavetableOscillator::WavetableOscillator(AudioContext& ctx) : Instrument(ctx), frames(DefaultFrames())
+{
+    numChans      = 1;
+    phase         = 0;
+    frameA.assign(bufferSize, PfxSample(0));
+    frameB.assign(bufferSize, PfxSample(0));
+    for (unsigned i=0; i<bufferSize; i++)
+        outputSamples[0][i] = 0.0;
+    usingEnvelope = false;
+}
+
+void WavetableOscillator::SetFrames(shared_ptr<const WavetableFrames> set)
+{
+    if (!set)
+        return;
+    frames = set;
+    if (position.Current() > frames->Frames() - 1 || position.Target() > frames->Frames() - 1)
+        position.SetTarget(frames->Frames() - 1, 0);
+}
+
+void WavetableOscillator::SetFreq(int pitch)
+{
+    SetFreq(MidiToFrequency(pitch));
+}
+
+void WavetableOscillator::SetFreq(double freq)
+{
+    frequency.SetTarget(freq);
+}
+
+void WavetableOscillator::SetGlide(double ms, SmoothedValue::smoothMode m)
+{
+    frequency.SetMode(m);
+    frequency.SetRamp(MsToSamples(ms));
+}
+
+void WavetableOscillator::SetPosition(double frame)
+{
+    double top = frames->Frames() - 1;
+    position.SetTarget((frame < 0.0) ? 0.0 : (frame > top) ? top : frame);
+}
+
+void WavetableOscillator::SetPositionGlide(double ms, SmoothedValue::smoothMode m)
+{
+    position.SetMode(m);
+    position.SetRamp(MsToSamples(ms));
+}
+
+void WavetableOscillator::TurnOn(double freq)
+{
+    active = true;
+    frequency.SetTarget(freq, 0);
+    Wake();
+}
+
+/*
+ One stretch [first, end) over which frequency and position are both
+ linear.  It is cut again wherever the position crosses a whole frame, so
+ each span reads one fixed pair of frames at one mipmap level.  A span
+ that sits exactly on a frame reads only that frame.
+*/
+void WavetableOscillator::RenderSpan(PfxSample* out, int first, int end, double& f, double df, double pos, double dp, double vol)
+{
+    const WavetableFrames& set   = *frames;
+    const long             size  = set.Size();
+    const int              last  = set.Frames() - 1;
+    const int              shift = 64 - (int)log2((double)size);
+    const uint64_t         mask  = (1ULL << shift) - 1;
+    const double           scale = ldexp(1.0, -shift);
+    const double           perHz = 1.0 / samplingRate;
+
+    int e;
+    frexp(fmax(fabs(f), fabs(f + df * (end - first))) * size * perHz, &e);   // increment < 2^e positions per sample
+    const int level = (e < 0) ? 0 : e;
+
+    // Both ends of the span are held below Nyquist, so the glide between
+    // them never leaves int64 and never wraps into a reversed pitch.
+    double   span  = end - first;
+    double   cyc0  = fmin(fmax(f * perHz, -0.5), 0.4999999);
+    double   cyc1  = fmin(fmax((f + df * span) * perHz, -0.5), 0.4999999);
+    uint64_t step  = (uint64_t)(int64_t)ldexp(cyc0, 64);           // phase units per sample; negative wraps
+    int64_t  dstep = (span > 0.0) ? (int64_t)ldexp((cyc1 - cyc0) / span, 64) : 0;
+    uint64_t ph    = phase;
+
+    for (int j=first; j<end; )
+    {
+        double p  = (pos < 0.0) ? 0.0 : (pos > last) ? last : pos;
+        int    fa = (last > 0 && (int)p >= last) ? last - 1 : (int)p;
+        double x  = p - fa;
+        int    n  = end - j;
+
+        if (dp != 0.0 && last > 0)
+        {
+            int k = (int)(((dp > 0.0) ? 1.0 - x : x) / fabs(dp));
+            if (k < 1) k = 1;
+            if (k < n) n = k;
+        }
+
+        const PfxSample* a = set.Frame(fa, level);
+        const PfxSample* b = set.Frame(fa + 1, level);
+        bool single = (last == 0) || (dp == 0.0 && (x == 0.0 || x == 1.0));
+
+        if (single)
+        {
+            if (x == 1.0)
+                a = b;
+            for (int i=0; i<n; i++)
+            {
+                uint64_t i1 = ph >> shift;
+                double   fr = (ph & mask) * scale;
+                out[j + i] = (a[i1] + fr * (a[i1 + 1] - a[i1])) * vol;
+                ph   += step;
+                step += dstep;
+            }
+        }
+        else
+        {
+            PfxSample* ra = frameA.data();
+            PfxSample* rb = frameB.data();
+            for (int i=0; i<n; i++)
+            {
+                uint64_t i1 = ph >> shift;
+                double   fr = (ph & mask) * scale;
+                ra[i] = (a[i1] + fr * (a[i1 + 1] - a[i1])) * vol;
+                rb[i] = (b[i1] + fr * (b[i1 + 1] - b[i1])) * vol;
+                ph   += step;
+                step += dstep;
+            }
+            KernelCrossfade(out + j, ra, rb, x, dp, n);
+        }
+        pos += dp * n;
+        j   += n;
+    }
+    phase = ph;
+    f    += df * (end - first);
+}
+
+void WavetableOscillator::Process(int first, int count)
+{
+    if (!active || !frames)
+        return;
+    if (first + count > (int)bufferSize)
+        count = (int)bufferSize - first;        // frameA and frameB hold one block; never grow them here
+    if (EnvelopeDone())
+    {
+        KernelZero(outputSamples[0]+first, count);
+        return;
+    }
+
+    PfxSample* out   = outputSamples[0];
+    double     vol   = volume.Value();
+    double     f     = 0.0, df = 0.0;
+    unsigned   fLeft = 0;                       // samples left in the current frequency piece
+    int        j     = first, last = first + count;
+
+    while (j < last)                            // pieces where frequency and position are both linear
+    {
+        double p, dp;
+        if (fLeft == 0)
+            fLeft = frequency.Segment(last - j, f, df);
+        unsigned n = position.Segment(fLeft, p, dp);
+        RenderSpan(out, j, j + n, f, df, p, dp, vol);
+        fLeft -= n;
+        j     += n;
+    }
+
+    if (usingEnvelope)
+        ApplyEnvelope(first, count);
+}
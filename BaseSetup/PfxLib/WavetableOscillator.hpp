@@ -0,0 +1,77 @@
+//
+//  WavetableOscillator.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  An Instrument that plays a stack of single-cycle frames and sweeps its
+//  timbre by crossfading between adjacent frames.  The frames live in an
+//  immutable WavetableFrames set, built once off the audio thread (from
+//  the Oscillator shapes or from user data) with one band-limited mipmap
+//  level per octave, and shared between voices; Process only reads it.
+//
+//  The position (0 .. frames-1, fractional values blend the two frames
+//  either side) is a SmoothedValue, so sweeps glide without zipper noise.
+//  Each block is cut into spans over which the frame pair and mipmap
+//  level are fixed: a scalar pass reads both frames with a 64-bit phase
+//  accumulator, then KernelCrossfade blends them with the position ramp.
+//  Nothing allocates or rebuilds while sweeping.
+//
+
+#pragma once
+
+#include "Instrument.hpp"
+#include "WavetableCache.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+using namespace std;
+
+class WavetableFrames
+{
+    long              size;                     // samples per frame; a power of two
+    int               frames;
+    int               levels;                   // band-limited copies of each frame, full bandwidth first
+    long              stride;                   // samples from one (frame, level) table to the next, guards included
+    vector<PfxSample> storage;
+
+    WavetableFrames(const PfxSample* data, int count, long n);
+
+public:
+    static const long kDefaultSize = 2048;
+
+    /* both return nullptr unless the size is a power of two and there is at least one frame */
+    static shared_ptr<const WavetableFrames> FromSamples(const PfxSample* data, int count, long n);      // 'count' frames of 'n' samples, back to back
+    static shared_ptr<const WavetableFrames> FromShapes(const vector<Wavetable::shape>& shapes, long n = kDefaultSize);
+
+    int               Frames(void) const        { return frames; }
+    int               Levels(void) const        { return levels; }
+    long              Size(void) const          { return size;   }
+    const PfxSample*  Frame(int f, int level) const;    // has Wavetable's guard points
+};
+
+class WavetableOscillator : public Instrument
+{
+    shared_ptr<const WavetableFrames> frames;
+    SmoothedValue     frequency;                // Hz
+    SmoothedValue     position;                 // frame, 0 .. Frames()-1
+    uint64_t          phase;                    // a full cycle is 2^64; the top bits index the frame
+    vector<PfxSample> frameA, frameB;           // the two frames of the current span, read at the current phase
+
+    void     RenderSpan(PfxSample* out, int first, int end, double& f, double df, double pos, double dp, double vol);
+
+public:
+             WavetableOscillator(void);
+             WavetableOscillator(AudioContext& ctx);
+
+    shared_ptr<const WavetableFrames> GetFrames(void) const { return frames; }
+    void     SetFrames(shared_ptr<const WavetableFrames> set);      // between blocks; the position is clamped to the new set
+    double   GetFreq(void) const                { return frequency.Current(); }
+    double   GetPosition(void) const            { return position.Current();  }
+    void     SetFreq(double freq) override;
+    void     SetFreq(int pitch)   override;
+    void     SetGlide(double ms, SmoothedValue::smoothMode m = SmoothedValue::kExponential);
+    void     SetPosition(double frame);                             // glides over the SetPositionGlide time
+    void     SetPositionGlide(double ms, SmoothedValue::smoothMode m = SmoothedValue::kLinear);
+    void     TurnOn(double freq=440.0) override;
+    void     Process(int first, int count) override;
+    void     ZeroPhase(void)                    { phase = 0; }
+};
@@ -0,0 +1,162 @@
+//
+//  WorkerPool.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+
+#include "WorkerPool.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    static inline void CpuPause(void) { _mm_pause(); }
+#elif defined(__aarch64__)
+    static inline void CpuPause(void) { __asm__ __volatile__("yield"); }
+#else
+    static inline void CpuPause(void) {}
+#endif
+
+static const int kSpinCount = 4096;             // pause loops before an idle helper sleeps
+
+WorkerPool::WorkerPool(int numThreads, void (*init)(void)) : generation(0), sleepers(0), remaining(0), quit(false), function(nullptr), context(nullptr), threadInit(init)
+{
+    if (numThreads < 1)           numThreads = 1;
+    if (numThreads > kMaxWorkers) numThreads = kMaxWorkers;
+    numWorkers = numThreads;
+
+    for (int i=0; i<kMaxWorkers; i++)
+    {
+        deques[i].top    = 0;
+        deques[i].bottom = 0;
+    }
+    for (int i=1; i<numWorkers; i++)
+        helpers[i] = thread(&WorkerPool::HelperLoop, this, i);
+}
+
+WorkerPool::~WorkerPool(void)
+{
+    quit = true;
+    generation.fetch_add(1);
+    generation.notify_all();
+    for (int i=1; i<numWorkers; i++)
+        helpers[i].join();
+}
+
+/*
+ The deques follow Chase and Lev: the owner works at the bottom, thieves
+ take from the top, and only the race for the last job needs a CAS.  The
+ indices only ever grow, so a deque never has to be reset between Runs.
+*/
+void WorkerPool::Push(int worker, int job)
+{
+    Deque& d = deques[worker];
+    long   b = d.bottom.load(memory_order_relaxed);
+
+    d.jobs[b & (kDequeSize-1)].store(job, memory_order_relaxed);
+    d.bottom.store(b+1, memory_order_release);
+}
+
+bool WorkerPool::Pop(int worker, int& job)
+{
+    Deque& d = deques[worker];
+    long   b = d.bottom.load(memory_order_relaxed) - 1;
+
+    d.bottom.store(b, memory_order_seq_cst);
+    long t = d.top.load(memory_order_seq_cst);
+    if (t > b)                                  // empty
+    {
+        d.bottom.store(b+1, memory_order_relaxed);
+        return false;
+    }
+
+    job = d.jobs[b & (kDequeSize-1)].load(memory_order_relaxed);
+    if (t == b)                                 // last job: race the thieves for it
+    {
+        bool won = d.top.compare_exchange_strong(t, t+1, memory_order_seq_cst, memory_order_relaxed);
+        d.bottom.store(b+1, memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool WorkerPool::Steal(int thief, int& job)
+{
+    for (int i=1; i<numWorkers; i++)
+    {
+        Deque& d = deques[(thief + i) % numWorkers];
+        long   t = d.top.load(memory_order_seq_cst);
+        long   b = d.bottom.load(memory_order_seq_cst);
+        if (t >= b) continue;
+
+        job = d.jobs[t & (kDequeSize-1)].load(memory_order_relaxed);
+        if (d.top.compare_exchange_strong(t, t+1, memory_order_seq_cst, memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+bool WorkerPool::NextJob(int worker, int& job)
+{
+    return Pop(worker, job) || Steal(worker, job);
+}
+
+void WorkerPool::Work(int worker)
+{
+    int job;
+
+    while (remaining.load(memory_order_acquire) > 0)
+    {
+        if (NextJob(worker, job))
+        {
+            (*function)(context, job, worker);
+            remaining.fetch_sub(1, memory_order_acq_rel);
+        }
+        else
+            CpuPause();
+    }
+}
+
+void WorkerPool::HelperLoop(int worker)
+{
+    unsigned seen = generation.load();
+
+    if (threadInit) (*threadInit)();
+    while (true)
+    {
+        for (int spin=0; spin<kSpinCount && generation.load(memory_order_acquire) == seen; spin++)
+            CpuPause();
+        sleepers.fetch_add(1, memory_order_seq_cst);
+        generation.wait(seen, memory_order_seq_cst);
+        sleepers.fetch_sub(1, memory_order_relaxed);
+        seen = generation.load(memory_order_acquire);
+        if (quit) return;
+        Work(worker);
+    }
+}
+
+/*
+ Run 'numJobs' jobs, starting from 'roots'.  A job makes further jobs ready
+ by calling Push from inside 'fun' with the worker index it was given.  The
+ calling thread works too, and Run returns only once every job has finished.
+*/
+void WorkerPool::Run(jobfun fun, void* ctx, const int* roots, int numRoots, int numJobs)
+{
+    if (numJobs <= 0) return;
+
+    function = fun;
+    context  = ctx;
+    remaining.store(numJobs, memory_order_release);    // before any job can be stolen and finished
+    for (int i=0; i<numRoots; i++)
+        Push(0, roots[i]);
+
+    /*
+     A helper counts itself a sleeper before its wait compares generation,
+     so either the bump below is seen by that compare or the count is seen
+     here; a pool that is still spinning costs no system call.
+    */
+    if (numWorkers > 1)
+    {
+        generation.fetch_add(1, memory_order_seq_cst);
+        if (sleepers.load(memory_order_seq_cst) > 0)
+            generation.notify_all();
+    }
+    Work(0);
+}
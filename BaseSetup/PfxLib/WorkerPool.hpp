@@ -0,0 +1,60 @@
+//
+//  WorkerPool.hpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  A fixed set of helper threads that run numbered jobs alongside the
+//  calling (audio) thread.  Each thread owns a fixed-size work-stealing
+//  deque: it pushes and pops its own jobs at the bottom, idle threads
+//  steal from the top.  Nothing in Run() allocates or takes a lock; idle
+//  helpers spin briefly and then sleep on an atomic until the next Run(),
+//  which only makes the wake call when a helper has actually gone to sleep.
+//
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+using namespace std;
+
+typedef void (*jobfun)(void* context, int job, int worker);
+
+class WorkerPool
+{
+public:
+    static const int kMaxWorkers = 16;          // including the calling thread
+    static const int kDequeSize  = 512;         // jobs per deque; must be a power of two
+
+private:
+    struct Deque
+    {
+        alignas(64) atomic<long> top;
+        alignas(64) atomic<long> bottom;
+        atomic<int>              jobs[kDequeSize];
+    };
+
+    int              numWorkers;                // helpers + 1 for the caller of Run
+    thread           helpers[kMaxWorkers];
+    Deque            deques[kMaxWorkers];
+    atomic<unsigned> generation;                // bumped by Run to wake helpers
+    atomic<int>      sleepers;                  // helpers blocked (or about to block) in generation.wait
+    atomic<int>      remaining;                 // jobs of the current Run not yet finished
+    atomic<bool>     quit;
+    jobfun           function;
+    void*            context;
+    void           (*threadInit)(void);        // called on each helper as it starts
+
+public:
+             WorkerPool(int numThreads, void (*init)(void) = nullptr);   // numThreads includes the caller
+            ~WorkerPool(void);
+
+    int      NumWorkers(void) const { return numWorkers; }
+    void     Push(int worker, int job);         // queue 'job' on 'worker's deque; only that worker may call this
+    void     Run(jobfun fun, void* ctx, const int* roots, int numRoots, int numJobs);
+
+private:
+    bool     Pop(int worker, int& job);
+    bool     Steal(int thief, int& job);
+    bool     NextJob(int worker, int& job);
+    void     Work(int worker);                  // run jobs until the current Run is complete
+    void     HelperLoop(int worker);
+};
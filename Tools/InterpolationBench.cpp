@@ -0,0 +1,91 @@
+//
+//  InterpolationBench.cpp
+//  Created by Robert Rowe on 10/17/26.
+//
+//  Cost and quality of each Oscillator table interpolation mode.  For a
+//  range of table sizes and pitches it renders a sine from a fresh
+//  Oscillator and reports the render time per sample and THD+N: the power
+//  of (output - ideal sine) relative to the power of the ideal sine, in dB.
+//  Every mode reads the same band-limited table, so the difference is the
+//  interpolator alone.  Pick the cheapest mode whose THD+N is below what
+//  the patch can expose.
+//
+//  Not part of the app target.  Build from this directory with
+//
+//      c++ -O2 -std=c++20 -I../BaseSetup/PfxLib InterpolationBench.cpp $(ls ../BaseSetup/PfxLib/*.cpp | grep -v Pfx.cpp) -o InterpolationBench
+//
+//  (Pfx.cpp is the CoreAudio host and is not needed here.)
+//
+
+#include "AudioContext.hpp"
+#include "Oscillator.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+static const double   kRate       = 48000.0;
+static const unsigned kBlock      = 256;
+static const int      kTimeBlocks = 20000;      // blocks rendered for timing
+static const int      kTestBlocks = 200;        // blocks compared with the ideal sine
+
+struct Result
+{
+    double nsPerSample;
+    double thdnDb;
+};
+
+static Result Measure(AudioContext& ctx, Interpolation::mode m, long size, double freq)
+{
+    Result     r;
+    Oscillator osc(ctx);
+
+    osc.FillTable(Oscillator::kSine, size);
+    osc.SetInterpolation(m);
+    osc.TurnOn(freq);
+
+    double signal = 0.0, error = 0.0;
+    long   n      = 0;
+    for (int b=0; b<kTestBlocks; b++)
+    {
+        osc.Process(0, kBlock);
+        const PfxSample* out = osc.OutputSamples(0);
+        for (unsigned i=0; i<kBlock; i++, n++)
+        {
+            double ideal = sin(2.0 * M_PI * fmod(freq * n / kRate, 1.0));
+            signal += ideal * ideal;
+            error  += (out[i] - ideal) * (out[i] - ideal);
+        }
+    }
+    r.thdnDb = 10.0 * log10(fmax(error, 1e-30) / signal);
+
+    auto start = chrono::steady_clock::now();
+    for (int b=0; b<kTimeBlocks; b++)
+        osc.Process(0, kBlock);
+    chrono::duration<double, nano> took = chrono::steady_clock::now() - start;
+    r.nsPerSample = took.count() / (double(kTimeBlocks) * kBlock);
+    return r;
+}
+
+int main(void)
+{
+    AudioContext ctx(kRate, kBlock);
+    const Interpolation::mode modes[] = { Interpolation::kTruncate, Interpolation::kLinear,
+                                          Interpolation::kHermite,  Interpolation::kLagrange };
+    const long   sizes[] = { 256, 2048, 8192 };
+    const double freqs[] = { 110.0, 1760.0, 7040.0 };
+
+    printf("%-9s %6s %8s %12s %12s\n", "mode", "table", "freq", "ns/sample", "THD+N (dB)");
+    for (long size : sizes)
+        for (double freq : freqs)
+        {
+            for (Interpolation::mode m : modes)
+            {
+                Result r = Measure(ctx, m, size, freq);
+                printf("%-9s %6ld %8.0f %12.2f %12.1f\n", Interpolation::Name(m), size, freq, r.nsPerSample, r.thdnDb);
+            }
+            printf("\n");
+        }
+    return 0;
+}